@@ -0,0 +1,163 @@
+#pragma once
+
+// minimal in-tree benchmark harness (no external dependencies):
+//   - every case runs `iterations` operations per call; the harness calibrates the count so one
+//     sample takes about `sampleTime`, then takes `samples` samples and keeps ns per operation
+//   - results are printed as a table and written as JSON (one object per case), so runs of
+//     different commits can be diffed by a script
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// keep `value` alive so the optimizer cannot drop the work that produced it
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(_MSC_VER)
+    static volatile const void* sink;
+    sink = &value;
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+struct Case {
+    std::string name;
+    std::uint64_t itemsPerOp = 1; // e.g. lookups per operation, for the items/s column
+    std::function<void(std::uint64_t iterations)> run;
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0; // per sample
+    std::uint64_t itemsPerOp = 1;
+    std::vector<double> nsPerOp; // one entry per sample
+
+    double median() const {
+        std::vector<double> v = nsPerOp;
+        std::sort(v.begin(), v.end());
+        const std::size_t n = v.size();
+        return n == 0 ? 0.0 : (n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0);
+    }
+    double min() const { return nsPerOp.empty() ? 0.0 : *std::min_element(nsPerOp.begin(), nsPerOp.end()); }
+    double mean() const {
+        double sum = 0.0;
+        for (double x : nsPerOp) sum += x;
+        return nsPerOp.empty() ? 0.0 : sum / static_cast<double>(nsPerOp.size());
+    }
+    double stddev() const {
+        if (nsPerOp.size() < 2) return 0.0;
+        const double m = mean();
+        double sq = 0.0;
+        for (double x : nsPerOp) sq += (x - m) * (x - m);
+        return std::sqrt(sq / static_cast<double>(nsPerOp.size() - 1));
+    }
+};
+
+class Runner {
+private:
+    std::vector<Case> cases;
+    std::chrono::nanoseconds sampleTime;
+    int samples;
+
+    static double secondsOf(const Case& c, std::uint64_t iterations) {
+        const auto t0 = std::chrono::steady_clock::now();
+        c.run(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // double the iteration count until one call is long enough to time, then scale to sampleTime
+    std::uint64_t calibrate(const Case& c) const {
+        const double target = std::chrono::duration<double>(sampleTime).count();
+        std::uint64_t n = 1;
+        while (true) {
+            const double s = secondsOf(c, n);
+            if (s >= target / 10.0 || n >= (1ull << 40)) {
+                const double scaled = static_cast<double>(n) * target / std::max(s, 1e-9);
+                return std::max<std::uint64_t>(1, static_cast<std::uint64_t>(scaled));
+            }
+            n *= 2;
+        }
+    }
+
+public:
+    explicit Runner(std::chrono::milliseconds sampleMs = std::chrono::milliseconds(20), int sampleCount = 10)
+        : sampleTime(sampleMs), samples(sampleCount) {}
+
+    void add(std::string name, std::function<void(std::uint64_t)> run, std::uint64_t itemsPerOp = 1) {
+        cases.push_back({std::move(name), itemsPerOp, std::move(run)});
+    }
+
+    const std::vector<Case>& all() const { return cases; }
+
+    // run every case whose name contains `filter` (all when empty)
+    std::vector<Result> run(const std::string& filter, std::ostream& log) const {
+        std::vector<Result> results;
+        log << std::left << std::setw(44) << "benchmark" << std::right << std::setw(12) << "iterations"
+            << std::setw(14) << "ns/op" << std::setw(14) << "min ns/op" << std::setw(10) << "+-%"
+            << std::setw(16) << "items/s" << "\n";
+        for (const Case& c : cases) {
+            if (!filter.empty() && c.name.find(filter) == std::string::npos) continue;
+            Result r;
+            r.name = c.name;
+            r.itemsPerOp = c.itemsPerOp;
+            r.iterations = calibrate(c);
+            for (int i = 0; i < samples; ++i)
+                r.nsPerOp.push_back(secondsOf(c, r.iterations) * 1e9 / static_cast<double>(r.iterations));
+            const double med = r.median();
+            log << std::left << std::setw(44) << r.name << std::right << std::setw(12) << r.iterations
+                << std::fixed << std::setprecision(1) << std::setw(14) << med << std::setw(14) << r.min()
+                << std::setw(10) << (med > 0.0 ? 100.0 * r.stddev() / med : 0.0)
+                << std::setprecision(0) << std::setw(16) << (med > 0.0 ? 1e9 * static_cast<double>(r.itemsPerOp) / med : 0.0)
+                << std::defaultfloat << "\n";
+            results.push_back(std::move(r));
+        }
+        return results;
+    }
+};
+
+inline void writeJsonString(std::ostream& os, const std::string& s) {
+    os << '"';
+    for (char ch : s) {
+        if (ch == '"' || ch == '\\') os << '\\';
+        os << ch;
+    }
+    os << '"';
+}
+
+// {"context": {...}, "benchmarks": [{"name", "iterations", "samples", "ns_per_op": {...}, "items_per_second"}]}
+inline void writeJson(std::ostream& os, const std::vector<Result>& results,
+                      const std::vector<std::pair<std::string, std::string>>& context) {
+    os << "{\n  \"context\": {";
+    for (std::size_t i = 0; i < context.size(); ++i) {
+        os << (i ? ", " : "");
+        writeJsonString(os, context[i].first);
+        os << ": ";
+        writeJsonString(os, context[i].second);
+    }
+    os << "},\n  \"benchmarks\": [";
+    os << std::setprecision(6);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double med = r.median();
+        os << (i ? ",\n" : "\n") << "    {\"name\": ";
+        writeJsonString(os, r.name);
+        os << ", \"iterations\": " << r.iterations << ", \"samples\": " << r.nsPerOp.size()
+           << ", \"ns_per_op\": {\"median\": " << med << ", \"min\": " << r.min() << ", \"mean\": " << r.mean()
+           << ", \"stddev\": " << r.stddev() << "}"
+           << ", \"items_per_op\": " << r.itemsPerOp
+           << ", \"items_per_second\": " << (med > 0.0 ? 1e9 * static_cast<double>(r.itemsPerOp) / med : 0.0) << "}";
+    }
+    os << "\n  ]\n}\n" << std::defaultfloat;
+}
+
+} // namespace bench
@@ -0,0 +1,412 @@
+// oop_bench: microbenchmarks of the engine's hot paths at several map sizes (see Bench.h)
+//   oop_bench [--filter TEXT] [--json FILE] [--samples N] [--sample-ms MS] [--list]
+#include "Engine.h"
+#include "Bench.h"
+
+// friend of Game (see Engine.h): reaches the private phases the benchmarks time on their own
+class GameProbe {
+public:
+    static void handleCollisions(Game& g) {
+        g.handleCollisions(g.fireboy, g.map.respawnWorldPosForFire(), g.fireboyAtExit);
+        g.handleCollisions(g.watergirl, g.map.respawnWorldPosForWater(), g.watergirlAtExit);
+    }
+    static void placeCharacters(Game& g, const sf::Vector2f& fire, const sf::Vector2f& water) {
+        g.fireboy.setPosition(fire);
+        g.watergirl.setPosition(water);
+    }
+    static bool won(const Game& g) { return g.won; }
+};
+
+namespace {
+
+struct MapSize { int w, h; };
+constexpr MapSize SIZES[] = {{14, 9}, {64, 36}, {256, 144}};
+constexpr unsigned LEVEL_SEED = 12345;
+constexpr float STEP = 1.f / 120.f;
+constexpr std::size_t TABLE_SIZE = 1024; // precomputed inputs/positions, cycled through (power of two)
+
+std::string sizeName(const MapSize& s) { return std::to_string(s.w) + "x" + std::to_string(s.h); }
+
+// the unfiltered generator, so every size gets a level in one attempt
+Map benchLevel(const MapSize& s) {
+    Map level(s.w, s.h);
+    level.generateAscendingPlatforms(LEVEL_SEED);
+    return level;
+}
+
+std::vector<InputFrame> scriptedFrames(unsigned seed) {
+    ScriptedInput script(seed);
+    std::vector<InputFrame> frames(TABLE_SIZE);
+    for (InputFrame& f : frames) f = script.next();
+    return frames;
+}
+
+// random top-left corners of character boxes inside the level
+std::vector<sf::Vector2f> randomPositions(const Map& map, unsigned seed) {
+    std::mt19937 rng(seed);
+    const sf::FloatRect world = map.worldBounds();
+    std::uniform_real_distribution<float> x(0.f, world.width - Tile::getSize());
+    std::uniform_real_distribution<float> y(0.f, world.height - Tile::getSize());
+    std::vector<sf::Vector2f> out(TABLE_SIZE);
+    for (sf::Vector2f& p : out) p = {x(rng), y(rng)};
+    return out;
+}
+
+void addMapCases(bench::Runner& runner, const MapSize& s) {
+    const std::string n = sizeName(s);
+
+    runner.add("Map/construct/" + n, [s](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            Map m(s.w, s.h);
+            bench::doNotOptimize(m);
+        }
+    });
+
+    auto source = std::make_shared<const Map>(benchLevel(s));
+    runner.add("Map/copy/" + n, [source](std::uint64_t iterations) {
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            Map copy(*source);
+            bench::doNotOptimize(copy);
+        }
+    });
+
+    runner.add("Map/generateAscendingPlatforms/" + n, [s](std::uint64_t iterations) {
+        Map m(s.w, s.h);
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            m.generateAscendingPlatforms(LEVEL_SEED + static_cast<unsigned>(i));
+            bench::doNotOptimize(m);
+        }
+    });
+
+    auto points = std::make_shared<const std::vector<sf::Vector2f>>(randomPositions(*source, 7));
+    runner.add("Map/getTileTypeAtWorld/" + n, [source, points](std::uint64_t iterations) {
+        unsigned sum = 0;
+        for (std::uint64_t i = 0; i < iterations; ++i)
+            for (const sf::Vector2f& p : *points) sum += static_cast<unsigned>(source->getTileTypeAtWorld(p.x, p.y));
+        bench::doNotOptimize(sum);
+    }, TABLE_SIZE);
+}
+
+void addCharacterCases(bench::Runner& runner, const MapSize& s) {
+    auto level = std::make_shared<const Map>(benchLevel(s));
+    auto frames = std::make_shared<const std::vector<InputFrame>>(scriptedFrames(3));
+    runner.add("Character/update/" + sizeName(s), [level, frames](std::uint64_t iterations) {
+        Character ch("bench", Element::Fire, "", level->respawnWorldPosForFire());
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            const InputFrame& in = (*frames)[i & (TABLE_SIZE - 1)];
+            ch.beginStep();
+            if (in.isPressed(InputKey::FireLeft)) ch.moveLeft();
+            if (in.isPressed(InputKey::FireRight)) ch.moveRight();
+            if (in.isPressed(InputKey::FireJump)) ch.jump();
+            ch.update(STEP, *level);
+        }
+        bench::doNotOptimize(ch);
+    });
+}
+
+void addGameCases(bench::Runner& runner, const MapSize& s) {
+    const std::string n = sizeName(s);
+
+    // both characters are moved to random spots first, so the lookups cover the whole level
+    auto level = std::make_shared<const Map>(benchLevel(s));
+    auto spots = std::make_shared<const std::vector<sf::Vector2f>>(randomPositions(*level, 11));
+    runner.add("Game/handleCollisions/" + n, [level, spots](std::uint64_t iterations) {
+        Game game(*level, true);
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            GameProbe::placeCharacters(game, (*spots)[i & (TABLE_SIZE - 1)], (*spots)[(i + 1) & (TABLE_SIZE - 1)]);
+            GameProbe::handleCollisions(game);
+        }
+        bench::doNotOptimize(game);
+    }, 2);
+
+    // a full fixed step (input, entities, both characters, collisions); a won game stops
+    // simulating, so it is restarted (rare: only small levels get won by the script)
+    auto frames = std::make_shared<const std::vector<InputFrame>>(scriptedFrames(5));
+    runner.add("Game/tick/" + n, [level, frames](std::uint64_t iterations) {
+        auto game = std::make_unique<Game>(*level, true);
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            game->step((*frames)[i & (TABLE_SIZE - 1)]);
+            if (GameProbe::won(*game)) game = std::make_unique<Game>(*level, true);
+        }
+        bench::doNotOptimize(*game);
+    });
+
+    // the same step while 10 s of rewind history are captured
+    runner.add("Game/tickWithRewind/" + n, [level, frames](std::uint64_t iterations) {
+        auto game = std::make_unique<Game>(*level, true);
+        game->enableRewind(10.f);
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            game->step((*frames)[i & (TABLE_SIZE - 1)]);
+            if (GameProbe::won(*game)) {
+                game = std::make_unique<Game>(*level, true);
+                game->enableRewind(10.f);
+            }
+        }
+        bench::doNotOptimize(*game);
+    });
+
+    // jump to random ticks of a full 10 s history
+    runner.add("Game/rewindTo/" + n, [level, frames](std::uint64_t iterations) {
+        Game game(*level, true);
+        game.enableRewind(10.f);
+        for (std::size_t i = 0; i < 1200 && !GameProbe::won(game); ++i) game.step((*frames)[i & (TABLE_SIZE - 1)]);
+        const RewindBuffer& history = *game.rewindBuffer();
+        const std::uint64_t oldest = history.oldestTick(), span = history.newestTick() - oldest + 1;
+        std::mt19937 rng(13);
+        for (std::uint64_t i = 0; i < iterations; ++i) game.rewindTo(oldest + rng() % span);
+        bench::doNotOptimize(game);
+    });
+}
+
+// entity broadphase scaling: the same density (about one entity per four cells) at every count;
+// one operation is a step of the whole world
+void addEntityCases(bench::Runner& runner) {
+    const float s = Tile::getSize();
+    for (int n : {100, 1000, 2500, 5000, 10000}) {
+        const int side = static_cast<int>(std::ceil(std::sqrt(4.0 * n))) + 2;
+        auto map = std::make_shared<const Map>(side, side);
+        auto world = std::make_shared<EntityWorld>();
+        std::mt19937 rng(static_cast<unsigned>(n));
+        std::uniform_int_distribution<int> cell(0, side - 1);
+        std::uniform_int_distribution<int> kind(0, 19);
+        for (int i = 0; i < n; ++i) {
+            const sf::Vector2f pos(cell(rng) * s + 6.f, cell(rng) * s + 6.f);
+            const int k = kind(rng);
+            if (k < 14) world->spawn(EntityKind::Box, pos, {0.75f * s, 0.75f * s});
+            else if (k < 17) world->spawn(EntityKind::Walker, pos, {0.75f * s, 0.75f * s}, {(k % 2) ? 60.f : -60.f, 0.f});
+            else world->spawn(EntityKind::MovingPlatform, pos, {s, 0.25f * s}, {(k % 2) ? 40.f : -40.f, 0.f});
+        }
+        runner.add("EntityWorld/step/" + std::to_string(n), [map, world](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) world->step(STEP, *map);
+            bench::doNotOptimize(*world);
+        }, static_cast<std::uint64_t>(n));
+    }
+}
+
+// tile effects of one character box, one tile at a time (the lookup handleCollisions did
+// before the bitboards): 0 nothing, 1 exit, 2 hazard
+int tileEffectsPerTile(const Map& map, std::uint8_t self, const Map::CellRange& cells) {
+    int effect = 0;
+    for (int r = cells.row0; r <= cells.row1; ++r) {
+        for (int c = cells.col0; c <= cells.col1; ++c) {
+            const TileTraits& traits = tileTraits(map.getTileTypeAtGrid(c, r));
+            if (traits.hazardFor & self) return 2;
+            if (traits.exitFor & self) effect = 1;
+        }
+    }
+    return effect;
+}
+
+int tileEffectsBitboard(const Map& map, std::uint8_t self, const Map::CellRange& cells) {
+    const unsigned found = map.hazardAndExitFor(self, cells);
+    return (found & 1u) ? 2 : (found & 2u) ? 1 : 0;
+}
+
+// random tiles, mostly open space like a real level; hazards are rare
+Map randomTiles(int side) {
+    Map map(side, side);
+    std::mt19937 rng(static_cast<unsigned>(side));
+    std::uniform_int_distribution<int> roll(0, 99);
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            const int k = roll(rng);
+            const TileType t = k < 20 ? TileType::Solid : k == 20 ? TileType::Fire : k == 21 ? TileType::Water
+                             : k == 22 ? TileType::ExitFire : k == 23 ? TileType::ExitWater : TileType::Empty;
+            if (t != TileType::Empty) map.setTile(c, r, t);
+        }
+    }
+    return map;
+}
+
+// handleCollisions lookups on large random maps: per-tile reads vs bitboard words, for boxes
+// from character size (1 tile, up to 2x2 cells) to 32 tiles
+void addCollisionCases(bench::Runner& runner) {
+    const float s = Tile::getSize();
+    for (int side : {256, 1024, 4096}) {
+        auto map = std::make_shared<const Map>(randomTiles(side));
+        std::mt19937 rng(static_cast<unsigned>(side) + 1);
+        for (int tiles : {1, 4, 16, 32}) {
+            const float extent = static_cast<float>(tiles) * s;
+            std::uniform_real_distribution<float> pos(0.f, static_cast<float>(side) * s - extent);
+            auto boxes = std::make_shared<std::vector<Map::CellRange>>(TABLE_SIZE);
+            for (Map::CellRange& b : *boxes) b = Map::cellsOverlapping({{pos(rng), pos(rng)}, {extent, extent}});
+            const std::string n = std::to_string(side) + "x" + std::to_string(side) + "/box" + std::to_string(tiles);
+            auto lookups = [map, boxes](auto lookup) {
+                return [map, boxes, lookup](std::uint64_t iterations) {
+                    long long sum = 0;
+                    for (std::uint64_t i = 0; i < iterations; ++i)
+                        for (std::size_t k = 0; k < TABLE_SIZE; ++k)
+                            sum += lookup(*map, elementBit(k & 1 ? Element::Water : Element::Fire), (*boxes)[k]);
+                    bench::doNotOptimize(sum);
+                };
+            };
+            runner.add("Map/tileEffects/perTile/" + n, lookups(tileEffectsPerTile), TABLE_SIZE);
+            runner.add("Map/tileEffects/bitboard/" + n, lookups(tileEffectsBitboard), TABLE_SIZE);
+        }
+    }
+}
+
+// one thread, and every core when there is more than one
+std::vector<unsigned> threadCounts() {
+    const unsigned cores = std::thread::hardware_concurrency();
+    return cores > 1 ? std::vector<unsigned>{1u, cores} : std::vector<unsigned>{1u};
+}
+
+// one 60 Hz frame of particles at a steady 100k live (the dead are replaced before each update),
+// on one thread and, as /threadsN, on every core
+void addParticleCases(bench::Runner& runner) {
+    constexpr std::size_t LIVE = 100000;
+    const ParticleStyle style{{-60.f, -200.f}, {60.f, -50.f}, 300.f, 0.5f, 1.5f, 4.f,
+                              sf::Color(255, 220, 70), sf::Color(255, 80, 0)};
+    const sf::FloatRect area(0.f, 0.f, 960.f, 576.f);
+    for (unsigned threads : threadCounts()) {
+        auto particles = std::make_shared<ParticleSystem>(LIVE);
+        particles->setWorkers(threads);
+        particles->emit(style, area, static_cast<float>(LIVE));
+        const std::string name = "ParticleSystem/update/100000" + (threads > 1 ? "/threads" + std::to_string(threads) : std::string());
+        runner.add(name, [particles, style, area](std::uint64_t iterations) {
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                particles->emit(style, area, static_cast<float>(LIVE - particles->size()));
+                particles->update(1.f / 60.f);
+            }
+            bench::doNotOptimize(*particles);
+        }, LIVE);
+    }
+}
+
+// floors every 8 rows with gaps and wooden stretches, 6x6 blocks of water dropped above them
+// and a few fires on the wood
+Map flowLevel(int side) {
+    Map level(side, side);
+    std::mt19937 rng(static_cast<unsigned>(side));
+    std::uniform_int_distribution<int> roll(0, 99), spot(1, side - 10);
+    for (int r = 8; r < side; r += 8) {
+        for (int c = 0; c < side; ++c) {
+            const int k = roll(rng);
+            if (k >= 15) level.setTile(c, r, k < 30 ? TileType::Wood : TileType::Solid);
+        }
+    }
+    for (int i = 0; i < side * side / 2048; ++i) {
+        const int c0 = spot(rng), r0 = spot(rng);
+        for (int r = r0; r < r0 + 6; ++r)
+            for (int c = c0; c < c0 + 6; ++c)
+                if (level.getTileTypeAtGrid(c, r) == TileType::Empty) level.setTile(c, r, TileType::Water);
+    }
+    for (int i = 0; i < side / 16; ++i) {
+        const int c = spot(rng), r = spot(rng) / 8 * 8;
+        if (r > 0 && level.getTileTypeAtGrid(c, r) == TileType::Wood) level.setTile(c, r, TileType::Fire);
+    }
+    return level;
+}
+
+// the tile automaton from a fresh copy of that level for FLOW_STEPS steps (the first ones move
+// most; it settles later): awake blocks only vs every block (wakeAll), on one thread and every core
+void addFlowCases(bench::Runner& runner) {
+    constexpr std::uint32_t FLOW_STEPS = 120; // 8 s of play at FLOW_INTERVAL 8, 120 Hz
+    for (int side : {256, 1024}) {
+        auto level = std::make_shared<const Map>(flowLevel(side));
+        for (bool everyBlock : {false, true}) {
+            for (unsigned threads : threadCounts()) {
+                const std::string name = std::string("TileAutomaton/step/") + (everyBlock ? "all/" : "awake/") + std::to_string(side) +
+                                    "x" + std::to_string(side) + (threads > 1 ? "/threads" + std::to_string(threads) : std::string());
+                runner.add(name, [level, everyBlock, threads](std::uint64_t iterations) {
+                    const std::vector<Map::CellRange> noBodies;
+                    for (std::uint64_t i = 0; i < iterations; ++i) {
+                        Map map(*level);
+                        TileAutomaton flow;
+                        flow.setWorkers(threads);
+                        for (std::uint32_t k = 0; k < FLOW_STEPS; ++k) {
+                            if (everyBlock) flow.wakeAll();
+                            flow.step(map, k, noBodies);
+                        }
+                        bench::doNotOptimize(map);
+                    }
+                }, FLOW_STEPS);
+            }
+        }
+    }
+}
+
+std::string compilerName() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    return "msvc " + std::to_string(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+void printUsage() {
+    std::cout << "usage: oop_bench [--filter TEXT] [--json FILE] [--samples N] [--sample-ms MS] [--list]\n"
+                 "  results are written to bench_results.json unless --json is given\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    std::string filter, jsonPath = "bench_results.json";
+    int samples = 10, sampleMs = 20;
+    bool listOnly = false;
+    try {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const bool hasValue = i + 1 < args.size();
+            if (args[i] == "--filter" && hasValue) filter = args[++i];
+            else if (args[i] == "--json" && hasValue) jsonPath = args[++i];
+            else if (args[i] == "--samples" && hasValue) samples = std::max(1, std::stoi(args[++i]));
+            else if (args[i] == "--sample-ms" && hasValue) sampleMs = std::max(1, std::stoi(args[++i]));
+            else if (args[i] == "--list") listOnly = true;
+            else { printUsage(); return 1; }
+        }
+    } catch (const std::exception&) { // std::stoi on a malformed number
+        printUsage();
+        return 1;
+    }
+
+    bench::Runner runner(std::chrono::milliseconds(sampleMs), samples);
+    for (const MapSize& s : SIZES) addMapCases(runner, s);
+    // the solver filter as the game uses it (default level size only: big levels rarely pass)
+    runner.add("Map/generateSolvable/14x9", [](std::uint64_t iterations) {
+        Map m(14, 9);
+        for (std::uint64_t i = 0; i < iterations; ++i) {
+            m.generateAscendingPlatforms(LEVEL_SEED + static_cast<unsigned>(i),
+                                         [](const Map& level) { return LevelSolver::instance().isSolvable(level); });
+            bench::doNotOptimize(m);
+        }
+    });
+    for (const MapSize& s : SIZES) addCharacterCases(runner, s);
+    for (const MapSize& s : SIZES) addGameCases(runner, s);
+    addEntityCases(runner);
+    addCollisionCases(runner);
+    addParticleCases(runner);
+    addFlowCases(runner);
+
+    if (listOnly) {
+        for (const bench::Case& c : runner.all()) std::cout << c.name << "\n";
+        return 0;
+    }
+
+    const std::vector<bench::Result> results = runner.run(filter, std::cout);
+
+    std::ofstream json(jsonPath);
+    const auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::ostringstream date;
+    date << std::put_time(std::gmtime(&now), "%Y-%m-%dT%H:%M:%SZ");
+#ifdef NDEBUG
+    const std::string buildType = "release";
+#else
+    const std::string buildType = "debug";
+#endif
+    bench::writeJson(json, results, {{"date", date.str()}, {"compiler", compilerName()}, {"build", buildType},
+                                     {"hardware_threads", std::to_string(std::thread::hardware_concurrency())},
+                                     {"samples", std::to_string(samples)}, {"sample_ms", std::to_string(sampleMs)}});
+    if (!json) {
+        std::cout << "Cannot write " << jsonPath << "\n";
+        return 1;
+    }
+    std::cout << "Wrote " << jsonPath << "\n";
+    return 0;
+}
@@ -0,0 +1,3388 @@
+#pragma once
+
+// engine library (target `engine`): tiles, maps, entities, characters, the level solver and the game;
+// the larger out-of-line members live in src/Engine.cpp
+
+#if defined(__clang__)
+    #pragma clang diagnostic push
+    #pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#elif defined(_MSC_VER)
+    #pragma warning(push)
+    #pragma warning(disable : 4996) // MSVC: disable warnings for deprecated funcs
+#endif
+#include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+#include <future>
+#include <optional>
+#include <bit>
+#include <type_traits>
+
+#include "TileType.h"
+#include "LevelFormat.h"
+#include "MappedFile.h"
+
+#if defined(__clang__)
+    #pragma clang diagnostic pop
+#elif defined(_MSC_VER)
+    #pragma warning(pop)
+#endif
+
+
+
+// elements a character belongs to; each element is one bit in the tile trait masks below
+enum class Element : std::uint8_t { Fire, Water, Count };
+
+constexpr std::uint8_t elementBit(Element e) { return static_cast<std::uint8_t>(1u << static_cast<unsigned>(e)); }
+constexpr std::uint8_t ALL_ELEMENTS = (1u << static_cast<unsigned>(Element::Count)) - 1u;
+
+// what the tile automaton does with a tile type (see TileAutomaton)
+enum class TileRule : std::uint8_t {
+    Static,    // never changes by itself
+    Liquid,    // falls, slides off ledges and levels out; falling onto a Burning tile turns it Solid
+    Burning,   // sets Flammable neighbours alight (they become this type)
+    Flammable, // waits for a Burning neighbour
+};
+
+// how a tile type behaves for each element (bit masks of elementBit) and how it looks;
+// adding a tile type or an element only means extending this table
+struct TileTraits {
+    const char* name;
+    std::uint8_t solidFor;  // blocks movement / can be stood on
+    std::uint8_t hazardFor; // touching it costs a life
+    std::uint8_t exitFor;   // reaching it counts as being at the exit
+    std::uint32_t rgba;     // fill color (sf::Color integer form)
+    TileRule rule;          // how it moves or spreads on its own
+};
+
+constexpr std::array<TileTraits, static_cast<std::size_t>(TileType::Count)> TILE_TRAITS = {{
+    // name         solidFor                      hazardFor                     exitFor                       rgba         rule
+    {"Empty",     0,                            0,                            0,                            0x505050FFu, TileRule::Static},
+    {"Solid",     ALL_ELEMENTS,                 0,                            0,                            0x787878FFu, TileRule::Static},
+    {"Fire",      elementBit(Element::Fire),    elementBit(Element::Water),   0,                            0xFF0000FFu, TileRule::Burning},
+    {"Water",     elementBit(Element::Water),   elementBit(Element::Fire),    0,                            0x0000FFFFu, TileRule::Liquid},
+    {"ExitFire",  0,                            0,                            elementBit(Element::Fire),    0xFF8C00FFu, TileRule::Static},
+    {"ExitWater", 0,                            0,                            elementBit(Element::Water),   0x00C864FFu, TileRule::Static},
+    {"Wood",      ALL_ELEMENTS,                 0,                            0,                            0x8B5A2BFFu, TileRule::Flammable},
+}};
+
+constexpr const TileTraits& tileTraits(TileType t) { return TILE_TRAITS[static_cast<std::size_t>(t)]; }
+
+// set of tile types (bit t <-> TileType t) whose trait `field` shares a bit with `elements`,
+// e.g. tileTypesWhere(&TileTraits::hazardFor, elementBit(Element::Water)) -> {Fire}
+constexpr std::uint32_t tileTypesWhere(std::uint8_t TileTraits::*field, std::uint8_t elements) {
+    std::uint32_t types = 0;
+    for (std::size_t t = 0; t < TILE_TRAITS.size(); ++t)
+        if (TILE_TRAITS[t].*field & elements) types |= 1u << t;
+    return types;
+}
+
+// tileTypesWhere for every element mask, computed at compile time (index = element mask)
+using TileTypeSets = std::array<std::uint32_t, ALL_ELEMENTS + 1>;
+constexpr TileTypeSets tileTypeSets(std::uint8_t TileTraits::*field) {
+    TileTypeSets sets{};
+    for (std::size_t e = 0; e < sets.size(); ++e) sets[e] = tileTypesWhere(field, static_cast<std::uint8_t>(e));
+    return sets;
+}
+constexpr TileTypeSets SOLID_TYPES = tileTypeSets(&TileTraits::solidFor);
+constexpr TileTypeSets HAZARD_TYPES = tileTypeSets(&TileTraits::hazardFor);
+constexpr TileTypeSets EXIT_TYPES = tileTypeSets(&TileTraits::exitFor);
+
+inline std::string toString(TileType t) {
+    return t < TileType::Count ? tileTraits(t).name : "Unknown";
+}
+
+class Tile {
+private:
+    TileType type;
+    sf::RectangleShape rect; // visual representation (fallback)
+    int gx, gy; // grid coordinates (col,row)
+    static constexpr float TILE_SIZE = 48.f;
+
+    void initShape() {
+        rect.setSize({TILE_SIZE, TILE_SIZE});
+        rect.setPosition(gx * TILE_SIZE, gy * TILE_SIZE);
+        rect.setFillColor(colorFor(type));
+    }
+
+public:
+    // constructor parametric
+    explicit Tile(TileType t , int col , int row )
+        : type(t), gx(col), gy(row) {
+        initShape();
+    }
+
+    // copy / assign default are fine
+    Tile(const Tile& other) = default;
+    Tile& operator=(const Tile& other) = default;
+    ~Tile() = default;
+
+    TileType getType() const { return type; }
+    int getCol() const { return gx; }
+    int getRow() const { return gy; }
+    static float getSize() { return TILE_SIZE; }
+
+    // fill color used for a tile type (shared by Tile shapes and the batched map renderer)
+    static sf::Color colorFor(TileType t) {
+        return sf::Color(tileTraits(t).rgba);
+    }
+
+    // draw (const)
+    void draw(sf::RenderTarget& target) const {
+        if (type != TileType::Empty) target.draw(rect);
+        else {
+            // draw a faint empty tile if you want
+            // target.draw(rect);
+        }
+    }
+
+    // get bounding box in world coords
+    sf::FloatRect bounds() const {
+        return rect.getGlobalBounds();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Tile& t) {
+        os << "[" << toString(t.type) << " @" << t.gx << "," << t.gy << "]";
+        return os;
+    }
+};
+
+// -------------------------------
+// TileMapRenderer (batched map geometry: one vertex array per chunk of tiles)
+// -------------------------------
+class TileMapRenderer {
+private:
+    static constexpr int CHUNK_SIZE = 16; // tiles per chunk side
+    static constexpr std::size_t VERTICES_PER_TILE = 6; // two triangles per tile
+    static constexpr int PRELOAD_MARGIN = 1; // chunks built ahead of the view on every side
+    static constexpr int EVICT_MARGIN = 3; // chunks farther than this outside the view are dropped
+    static constexpr std::size_t MAX_SPARE_CHUNKS = 64; // evicted chunks kept to reuse their vertex storage
+
+    struct Chunk {
+        sf::VertexArray vertices{sf::Triangles};
+        std::array<TileType, CHUNK_SIZE * CHUNK_SIZE> shown{}; // tile type currently written into the vertices
+        int col0 = 0, row0 = 0, cols = 0, rows = 0;
+        int visibleTiles = 0; // non-empty tiles; empty chunks are skipped when drawing
+    };
+
+    // inclusive range of chunk coordinates
+    struct ChunkRange {
+        int cx0 = 0, cx1 = -1, cy0 = 0, cy1 = -1;
+        bool contains(int cx, int cy) const { return cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1; }
+    };
+
+    int width = 0, height = 0;
+    int chunksX = 0, chunksY = 0;
+    // only the chunks around the view have geometry, so memory does not grow with the level
+    std::unordered_map<std::uint64_t, Chunk> resident;
+    std::vector<Chunk> spare;
+    ChunkRange visible;
+    bool built = false;
+
+    std::uint64_t key(int cx, int cy) const {
+        return static_cast<std::uint64_t>(cy) * static_cast<std::uint64_t>(chunksX) + static_cast<std::uint64_t>(cx);
+    }
+
+    ChunkRange rangeFor(const sf::FloatRect& area, int margin) const {
+        const float s = Tile::getSize() * CHUNK_SIZE;
+        ChunkRange r;
+        r.cx0 = std::max(0, static_cast<int>(std::floor(area.left / s)) - margin);
+        r.cy0 = std::max(0, static_cast<int>(std::floor(area.top / s)) - margin);
+        r.cx1 = std::min(chunksX - 1, static_cast<int>(std::floor((area.left + area.width) / s)) + margin);
+        r.cy1 = std::min(chunksY - 1, static_cast<int>(std::floor((area.top + area.height) / s)) + margin);
+        return r;
+    }
+
+    // write the two triangles of one tile; empty tiles collapse to a degenerate quad
+    static void writeQuad(Chunk& ch, int col, int row, TileType t) {
+        const std::size_t local = static_cast<std::size_t>(row - ch.row0) * ch.cols + (col - ch.col0);
+        const std::size_t first = local * VERTICES_PER_TILE;
+        TileType& prev = ch.shown[local];
+        if (prev != TileType::Empty) --ch.visibleTiles;
+        if (t != TileType::Empty) ++ch.visibleTiles;
+        prev = t;
+
+        const float s = Tile::getSize();
+        const float x = col * s, y = row * s;
+        const float w = (t == TileType::Empty) ? 0.f : s;
+        const sf::Color color = Tile::colorFor(t);
+        const sf::Vector2f corners[VERTICES_PER_TILE] = {
+            {x, y}, {x + w, y}, {x + w, y + w},
+            {x, y}, {x + w, y + w}, {x, y + w}
+        };
+        for (std::size_t k = 0; k < VERTICES_PER_TILE; ++k) {
+            ch.vertices[first + k].position = corners[k];
+            ch.vertices[first + k].color = color;
+        }
+    }
+
+    void loadChunk(int cx, int cy, const std::uint8_t* tiles) {
+        Chunk ch;
+        if (!spare.empty()) {
+            ch = std::move(spare.back());
+            spare.pop_back();
+        }
+        ch.col0 = cx * CHUNK_SIZE;
+        ch.row0 = cy * CHUNK_SIZE;
+        ch.cols = std::min(CHUNK_SIZE, width - ch.col0);
+        ch.rows = std::min(CHUNK_SIZE, height - ch.row0);
+        ch.vertices.resize(static_cast<std::size_t>(ch.cols) * ch.rows * VERTICES_PER_TILE);
+        ch.shown.fill(TileType::Empty);
+        ch.visibleTiles = 0;
+        for (int r = ch.row0; r < ch.row0 + ch.rows; ++r)
+            for (int c = ch.col0; c < ch.col0 + ch.cols; ++c)
+                writeQuad(ch, c, r, static_cast<TileType>(tiles[static_cast<std::size_t>(r) * width + c]));
+        resident.emplace(key(cx, cy), std::move(ch));
+    }
+
+    void evictChunk(std::unordered_map<std::uint64_t, Chunk>::iterator it) {
+        if (spare.size() < MAX_SPARE_CHUNKS) spare.push_back(std::move(it->second));
+        resident.erase(it);
+    }
+
+public:
+    bool isBuilt() const { return built; }
+    std::size_t residentChunks() const { return resident.size(); }
+
+    // drop all geometry; the next reset() starts streaming from scratch
+    void invalidate() {
+        built = false;
+        for (auto it = resident.begin(); it != resident.end();) evictChunk(it++);
+        visible = ChunkRange{};
+    }
+
+    // start streaming a level of w x h tiles (no geometry is built yet)
+    void reset(int w, int h) {
+        invalidate();
+        width = w; height = h;
+        chunksX = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunksY = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        built = true;
+    }
+
+    // make the chunks under `area` (world coordinates) resident, plus a small margin so
+    // scrolling does not build on the frame a chunk appears; far chunks are evicted
+    void stream(const sf::FloatRect& area, const std::uint8_t* tiles) {
+        if (!built) return;
+        visible = rangeFor(area, 0);
+        const ChunkRange keep = rangeFor(area, EVICT_MARGIN);
+        for (auto it = resident.begin(); it != resident.end();) {
+            const int cx = it->second.col0 / CHUNK_SIZE, cy = it->second.row0 / CHUNK_SIZE;
+            if (keep.contains(cx, cy)) ++it;
+            else evictChunk(it++);
+        }
+        const ChunkRange load = rangeFor(area, PRELOAD_MARGIN);
+        for (int cy = load.cy0; cy <= load.cy1; ++cy)
+            for (int cx = load.cx0; cx <= load.cx1; ++cx)
+                if (!resident.contains(key(cx, cy))) loadChunk(cx, cy, tiles);
+    }
+
+    // incremental update: rewrite only the quad of the changed tile (if its chunk is resident;
+    // other chunks read the new value when they are streamed in)
+    void patchTile(int col, int row, TileType t) {
+        if (!built) return;
+        auto it = resident.find(key(col / CHUNK_SIZE, row / CHUNK_SIZE));
+        if (it != resident.end()) writeQuad(it->second, col, row, t);
+    }
+
+    // only the chunks inside the last streamed area are drawn; returns the number of draw calls
+    // (Target: an sf::RenderTarget or a SoftwareRenderer)
+    template <typename Target>
+    std::size_t draw(Target& target) const {
+        std::size_t calls = 0;
+        for (int cy = visible.cy0; cy <= visible.cy1; ++cy) {
+            for (int cx = visible.cx0; cx <= visible.cx1; ++cx) {
+                auto it = resident.find(key(cx, cy));
+                if (it != resident.end() && it->second.visibleTiles > 0) {
+                    target.draw(it->second.vertices);
+                    ++calls;
+                }
+            }
+        }
+        return calls;
+    }
+};
+
+// -------------------------------
+// TileBitboards (one bit per tile for every tile type, 64 columns per word)
+// -------------------------------
+// A region query reads one word per 64 columns and row instead of one byte per tile:
+// "any solid under this box" is an OR of masked words, "how many hazards" a popcount.
+class TileBitboards {
+private:
+    static constexpr int TYPES = static_cast<int>(TileType::Count);
+
+    int width = 0, height = 0;
+    int wordsPerRow = 0;
+    // [row][word][type], bit (col % 64) of word (col / 64): the words of all types for the same
+    // 64 tiles share a cache line, so merging types costs no extra misses
+    std::vector<std::uint64_t> words;
+
+    std::uint64_t& word(int type, int r, int w) {
+        return words[(static_cast<std::size_t>(r) * wordsPerRow + w) * TYPES + type];
+    }
+    const std::uint64_t* group(int r, int w) const {
+        return words.data() + (static_cast<std::size_t>(r) * wordsPerRow + w) * TYPES;
+    }
+
+    // bits lo..hi (inclusive, 0..63) of a word
+    static std::uint64_t span(int lo, int hi) {
+        return (~0ull >> (63 - hi)) & (~0ull << lo);
+    }
+
+    // call fn(word) with every word of the types in `types` that covers cols col0..col1 of row r,
+    // already masked to those columns; stops early when fn returns true
+    template <typename Fn>
+    bool scanRow(std::uint32_t types, int r, int col0, int col1, Fn&& fn) const {
+        const int w0 = col0 >> 6, w1 = col1 >> 6;
+        for (int w = w0; w <= w1; ++w) {
+            const std::uint64_t mask = span(w == w0 ? col0 & 63 : 0, w == w1 ? col1 & 63 : 63);
+            const std::uint64_t* g = group(r, w);
+            std::uint64_t merged = 0;
+            for (std::uint32_t t = types; t != 0; t &= t - 1) merged |= g[std::countr_zero(t)];
+            if (fn(merged & mask)) return true;
+        }
+        return false;
+    }
+
+public:
+    // rebuild from row-major tile codes
+    void build(const std::uint8_t* tiles, int w, int h) {
+        width = w; height = h;
+        wordsPerRow = (w + 63) / 64;
+        words.assign(static_cast<std::size_t>(TYPES) * h * wordsPerRow, 0);
+        for (int r = 0; r < h; ++r)
+            for (int c = 0; c < w; ++c)
+                word(tiles[static_cast<std::size_t>(r) * w + c], r, c >> 6) |= 1ull << (c & 63);
+    }
+
+    // move one tile from type `from` to type `to`
+    void set(int col, int r, TileType from, TileType to) {
+        const std::uint64_t bit = 1ull << (col & 63);
+        word(static_cast<int>(from), r, col >> 6) &= ~bit;
+        word(static_cast<int>(to), r, col >> 6) |= bit;
+    }
+
+    // the ranges below must lie inside the map (see Map for clipping)
+    bool any(std::uint32_t types, int col0, int col1, int row0, int row1) const {
+        for (int r = row0; r <= row1; ++r)
+            if (scanRow(types, r, col0, col1, [](std::uint64_t w) { return w != 0; })) return true;
+        return false;
+    }
+
+    // any() for two type sets in one pass: bit 0 <- typesA found, bit 1 <- typesB found.
+    // Stops at the first row with typesA, so bit 1 is only complete when bit 0 is clear
+    unsigned anyOfTwo(std::uint32_t typesA, std::uint32_t typesB, int col0, int col1, int row0, int row1) const {
+        std::uint64_t a = 0, b = 0;
+        const int w0 = col0 >> 6, w1 = col1 >> 6;
+        for (int r = row0; r <= row1 && a == 0; ++r) {
+            for (int w = w0; w <= w1; ++w) {
+                const std::uint64_t mask = span(w == w0 ? col0 & 63 : 0, w == w1 ? col1 & 63 : 63);
+                const std::uint64_t* g = group(r, w);
+                for (std::uint32_t t = typesA; t != 0; t &= t - 1) a |= g[std::countr_zero(t)] & mask;
+                for (std::uint32_t t = typesB; t != 0; t &= t - 1) b |= g[std::countr_zero(t)] & mask;
+            }
+        }
+        return (a != 0 ? 1u : 0u) | (b != 0 ? 2u : 0u);
+    }
+
+    int count(std::uint32_t types, int col0, int col1, int row0, int row1) const {
+        int n = 0;
+        for (int r = row0; r <= row1; ++r)
+            scanRow(types, r, col0, col1, [&n](std::uint64_t w) { n += std::popcount(w); return false; });
+        return n;
+    }
+
+    // one board with the union of `types` (row-major, same word layout)
+    std::vector<std::uint64_t> merged(std::uint32_t types) const {
+        std::vector<std::uint64_t> out(static_cast<std::size_t>(height) * wordsPerRow, 0);
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            const std::uint64_t* g = words.data() + i * TYPES;
+            for (std::uint32_t t = types; t != 0; t &= t - 1) out[i] |= g[std::countr_zero(t)];
+        }
+        return out;
+    }
+};
+
+// -------------------------------
+// TileMask (a single merged bitboard, e.g. every tile that blocks Fireboy)
+// -------------------------------
+// For callers that run many queries against the same set of tile types (LevelSolver):
+// each query is then one masked word per row and 64 columns, with no per-type merging.
+class TileMask {
+private:
+    std::vector<std::uint64_t> words;
+    int width = 0, height = 0, wordsPerRow = 0;
+    bool outside = false; // value of the cells outside the map
+
+public:
+    TileMask() = default;
+    TileMask(std::vector<std::uint64_t> bits, int w, int h, bool outsideValue)
+        : words(std::move(bits)), width(w), height(h), wordsPerRow((w + 63) / 64), outside(outsideValue) {}
+
+    bool any(int col0, int col1, int row0, int row1) const {
+        if (col0 > col1 || row0 > row1) return false;
+        if (col0 < 0 || row0 < 0 || col1 >= width || row1 >= height) {
+            if (outside) return true;
+            col0 = std::max(col0, 0); col1 = std::min(col1, width - 1);
+            row0 = std::max(row0, 0); row1 = std::min(row1, height - 1);
+            if (col0 > col1 || row0 > row1) return false;
+        }
+        const int w0 = col0 >> 6, w1 = col1 >> 6;
+        for (int r = row0; r <= row1; ++r) {
+            const std::uint64_t* line = words.data() + static_cast<std::size_t>(r) * wordsPerRow;
+            for (int w = w0; w <= w1; ++w) {
+                const int lo = w == w0 ? col0 & 63 : 0, hi = w == w1 ? col1 & 63 : 63;
+                if (line[w] & (~0ull >> (63 - hi)) & (~0ull << lo)) return true;
+            }
+        }
+        return false;
+    }
+};
+
+// -------------------------------
+// Map (contains Tiles) - implement copy ctor/operator=/destructor explicitly
+// -------------------------------
+class Map {
+private:
+    // tile types stored row-major (index = row * width + col), one byte per tile.
+    // `cells` points either into `ownedCells` or straight into a mapped level file
+    // (zero-copy, shared by copies of the map until the first write)
+    std::vector<std::uint8_t> ownedCells;
+    std::shared_ptr<const MappedFile> mapping;
+    const std::uint8_t* cells = nullptr;
+    int width, height;
+    sf::Vector2i fireSpawn, waterSpawn; // grid cells where the characters (re)spawn
+    TileBitboards bitboards; // kept in sync with every tile write (see setTile)
+    std::uint64_t revision = 0; // bumped by every change of the tiles (see tileRevision)
+
+    // visuals live apart from the tile data: built lazily from the tile bytes when drawing,
+    // patched per tile afterwards and never copied along with the map
+    mutable TileMapRenderer renderer;
+
+public:
+    // one tile write, as journaled for rewind (see recordTileChanges)
+    struct TileChange {
+        std::uint32_t index; // row * width + col
+        TileType before, after;
+    };
+
+private:
+    // tile writes since the last clearTileChanges (only while recording; not copied with the map)
+    std::vector<TileChange> tileChanges;
+    bool recordingChanges = false;
+
+    // helper to create grid
+    void allocateGrid(int w, int h, TileType defaultType = TileType::Empty) {
+        width = w; height = h;
+        mapping.reset();
+        ownedCells.assign(static_cast<std::size_t>(width) * height, static_cast<std::uint8_t>(defaultType));
+        cells = ownedCells.data();
+        fireSpawn = {1, height - 2};
+        waterSpawn = {5, height - 2};
+        bitboards.build(cells, width, height);
+        renderer.invalidate();
+        ++revision;
+    }
+
+    std::size_t index(int col, int row) const {
+        return static_cast<std::size_t>(row) * width + col;
+    }
+
+    // copy-on-write: a map still backed by a level file gets its own tile buffer before the first write
+    void makeWritable() {
+        if (!mapping) return;
+        ownedCells.assign(cells, cells + static_cast<std::size_t>(width) * height);
+        mapping.reset();
+        cells = ownedCells.data();
+    }
+
+public:
+    // constructor parametric
+    Map(int w = 12, int h = 8, TileType defaultType = TileType::Empty) {
+        allocateGrid(w,h,defaultType);
+    }
+
+    // copy constructor (explicit): a single buffer copy (or just another reference to the
+    // mapped level file), the render cache is rebuilt on demand
+    Map(const Map& other)
+        : ownedCells(other.ownedCells), mapping(other.mapping),
+          cells(other.mapping ? other.cells : ownedCells.data()),
+          width(other.width), height(other.height),
+          fireSpawn(other.fireSpawn), waterSpawn(other.waterSpawn), bitboards(other.bitboards),
+          revision(other.revision) {}
+
+    // move constructor: steals the tile buffer and the already built geometry
+    Map(Map&& other) noexcept
+        : ownedCells(std::move(other.ownedCells)), mapping(std::move(other.mapping)), cells(other.cells),
+          width(other.width), height(other.height), fireSpawn(other.fireSpawn), waterSpawn(other.waterSpawn),
+          bitboards(std::move(other.bitboards)), revision(other.revision), renderer(std::move(other.renderer)) {
+        other.cells = nullptr;
+        other.width = other.height = 0;
+        other.bitboards = TileBitboards{};
+        other.renderer.invalidate();
+    }
+
+    // copy assignment
+    Map& operator=(const Map& other) {
+        if (this == &other) return *this;
+        ownedCells = other.ownedCells;
+        mapping = other.mapping;
+        cells = mapping ? other.cells : ownedCells.data();
+        width = other.width;
+        height = other.height;
+        fireSpawn = other.fireSpawn;
+        waterSpawn = other.waterSpawn;
+        bitboards = other.bitboards;
+        revision = other.revision;
+        renderer.invalidate();
+        return *this;
+    }
+
+    Map& operator=(Map&& other) noexcept {
+        if (this == &other) return *this;
+        ownedCells = std::move(other.ownedCells);
+        mapping = std::move(other.mapping);
+        cells = other.cells;
+        width = other.width;
+        height = other.height;
+        fireSpawn = other.fireSpawn;
+        waterSpawn = other.waterSpawn;
+        bitboards = std::move(other.bitboards);
+        revision = other.revision;
+        renderer = std::move(other.renderer);
+        other.cells = nullptr;
+        other.width = other.height = 0;
+        other.bitboards = TileBitboards{};
+        other.renderer.invalidate();
+        return *this;
+    }
+
+    // destructor
+    ~Map() {
+        // No raw pointers, but destructor explicitly present to satisfy requirement.
+    }
+
+    // load a binary level (see LevelFormat.h): the file is memory-mapped and its tile bytes are
+    // used in place; they are read once to validate the tile codes and once to build the bitboards
+    bool loadFromFile(const std::string& path);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // write one tile (inside the map): the byte grid, the bitboards and the resident render chunk
+    void setTile(int col, int row, TileType t) {
+        assert(col >= 0 && col < width && row >= 0 && row < height);
+        makeWritable();
+        std::uint8_t& cell = ownedCells[index(col, row)];
+        if (recordingChanges && static_cast<TileType>(cell) != t)
+            tileChanges.push_back({static_cast<std::uint32_t>(index(col, row)), static_cast<TileType>(cell), t});
+        if (static_cast<TileType>(cell) != t) ++revision;
+        bitboards.set(col, row, static_cast<TileType>(cell), t);
+        cell = static_cast<std::uint8_t>(t);
+        renderer.patchTile(col, row, t);
+    }
+
+    // the tile bytes (row-major, width * height) and a counter that changes whenever they do,
+    // so a copy of the map can tell cheaply whether it is still current
+    const std::uint8_t* tileData() const { return cells; }
+    std::uint64_t tileRevision() const { return revision; }
+
+    // take over the tiles of a map of the same size (`src` as returned by tileData),
+    // writing only the ones that differ; not journaled
+    void assignTiles(const std::uint8_t* src) {
+        const std::size_t count = static_cast<std::size_t>(width) * height;
+        for (std::size_t i = 0; i < count; ++i)
+            if (cells[i] != src[i]) restoreTile(static_cast<std::uint32_t>(i), static_cast<TileType>(src[i]));
+    }
+
+    // journal every tile write from now on (RewindBuffer stores them per step)
+    void recordTileChanges(bool on) {
+        recordingChanges = on;
+        tileChanges.clear();
+        if (on) tileChanges.reserve(256);
+    }
+    const std::vector<TileChange>& pendingTileChanges() const { return tileChanges; }
+    void clearTileChanges() { tileChanges.clear(); } // keeps the capacity
+
+    // undo/redo a journaled write; not journaled itself
+    void restoreTile(std::uint32_t cellIndex, TileType t) {
+        const bool recording = recordingChanges;
+        recordingChanges = false;
+        setTile(static_cast<int>(cellIndex % static_cast<std::uint32_t>(width)),
+                static_cast<int>(cellIndex / static_cast<std::uint32_t>(width)), t);
+        recordingChanges = recording;
+    }
+
+    // generate with derived seeds until `accept` approves the level (e.g. LevelSolver::isSolvable);
+    // returns the attempt that was accepted, or 0 if none of maxAttempts was (the last one is kept)
+    // or the map is too small to generate on
+    template <typename Accept>
+    int generateAscendingPlatforms(unsigned seed, Accept&& accept, int maxAttempts = 64) {
+        for (int attempt = 1; attempt <= maxAttempts; ++attempt) {
+            if (!generateAscendingPlatforms(seed == 0 ? 0 : seed + static_cast<unsigned>(attempt - 1) * 0x9E3779B9u))
+                return 0;
+            if (accept(static_cast<const Map&>(*this))) return attempt;
+        }
+        return 0;
+    }
+
+    // complex public function: generate ascending platforms randomly
+    // "ascending" -> a floor with one fire and one water pool to jump, then a flight of steps
+    // going up to the right, one row per step; both exits sit side by side on the top landing.
+    // Needs at least MIN_GENERATED_WIDTH x MIN_GENERATED_HEIGHT tiles (room for the pools on the
+    // floor and the exits above a landing); a smaller map is left untouched and false returned
+    static constexpr int MIN_GENERATED_WIDTH = 8, MIN_GENERATED_HEIGHT = 4;
+    bool generateAscendingPlatforms(unsigned seed = 0);
+
+    // get tile type at world coords (x,y in pixels) OR by grid coords
+    TileType getTileTypeAtGrid(int col, int row) const {
+        if (col < 0 || col >= width || row < 0 || row >= height) return TileType::Solid;
+        return static_cast<TileType>(cells[index(col, row)]);
+    }
+
+    // get tile type by world position
+    TileType getTileTypeAtWorld(float x, float y) const {
+        int col = static_cast<int>(x / Tile::getSize());
+        int row = static_cast<int>(y / Tile::getSize());
+        return getTileTypeAtGrid(col, row);
+    }
+
+    // inclusive range of grid cells a world rectangle overlaps; edges that only touch a cell
+    // do not count (EDGE_EPSILON absorbs float error from snapping onto tile edges)
+    struct CellRange { int col0, col1, row0, row1; };
+    static constexpr float EDGE_EPSILON = 1e-3f;
+
+    static CellRange cellsOverlapping(const sf::FloatRect& r) {
+        const float s = Tile::getSize();
+        return {static_cast<int>(std::floor((r.left + EDGE_EPSILON) / s)),
+                static_cast<int>(std::ceil((r.left + r.width - EDGE_EPSILON) / s)) - 1,
+                static_cast<int>(std::floor((r.top + EDGE_EPSILON) / s)),
+                static_cast<int>(std::ceil((r.top + r.height - EDGE_EPSILON) / s)) - 1};
+    }
+
+    // number of cells in the inclusive range whose type is in `types` (bit t <-> TileType t, see
+    // tileTypesWhere). Cells outside the map count as Solid, so the map border is a wall
+    int countTiles(std::uint32_t types, int col0, int col1, int row0, int row1) const {
+        if (col0 > col1 || row0 > row1) return 0;
+        const int c0 = std::max(col0, 0), c1 = std::min(col1, width - 1);
+        const int r0 = std::max(row0, 0), r1 = std::min(row1, height - 1);
+        int n = 0;
+        if (types & (1u << static_cast<unsigned>(TileType::Solid))) {
+            const int inside = (c0 <= c1 && r0 <= r1) ? (c1 - c0 + 1) * (r1 - r0 + 1) : 0;
+            n += (col1 - col0 + 1) * (row1 - row0 + 1) - inside;
+        }
+        if (c0 <= c1 && r0 <= r1) n += bitboards.count(types, c0, c1, r0, r1);
+        return n;
+    }
+
+    // same as countTiles > 0, but stops at the first matching word
+    bool anyTile(std::uint32_t types, int col0, int col1, int row0, int row1) const {
+        if (col0 > col1 || row0 > row1) return false;
+        const int c0 = std::max(col0, 0), c1 = std::min(col1, width - 1);
+        const int r0 = std::max(row0, 0), r1 = std::min(row1, height - 1);
+        const bool clipped = c0 != col0 || c1 != col1 || r0 != row0 || r1 != row1;
+        if (clipped && (types & (1u << static_cast<unsigned>(TileType::Solid)))) return true;
+        return c0 <= c1 && r0 <= r1 && bitboards.any(types, c0, c1, r0, r1);
+    }
+
+    // true if any cell in the inclusive range is solid for one of the given elements
+    bool anySolidFor(std::uint8_t elements, int col0, int col1, int row0, int row1) const {
+        return anyTile(SOLID_TYPES[elements], col0, col1, row0, row1);
+    }
+
+    // hazard/exit lookup of handleCollisions in one pass (bit 0 hazard, bit 1 exit, which is only
+    // complete without a hazard); Solid is neither, so cells outside the map are simply skipped
+    unsigned hazardAndExitFor(std::uint8_t elements, const CellRange& r) const {
+        const int c0 = std::max(r.col0, 0), c1 = std::min(r.col1, width - 1);
+        const int r0 = std::max(r.row0, 0), r1 = std::min(r.row1, height - 1);
+        if (c0 > c1 || r0 > r1) return 0;
+        return bitboards.anyOfTwo(HAZARD_TYPES[elements], EXIT_TYPES[elements], c0, c1, r0, r1);
+    }
+
+    bool anyHazardFor(std::uint8_t elements, const CellRange& r) const {
+        return anyTile(HAZARD_TYPES[elements], r.col0, r.col1, r.row0, r.row1);
+    }
+
+    bool anyExitFor(std::uint8_t elements, const CellRange& r) const {
+        return anyTile(EXIT_TYPES[elements], r.col0, r.col1, r.row0, r.row1);
+    }
+
+    // merged bitboard of `types` for repeated queries (outside cells count as Solid)
+    TileMask tileMask(std::uint32_t types) const {
+        return TileMask(bitboards.merged(types), width, height, (types & (1u << static_cast<unsigned>(TileType::Solid))) != 0);
+    }
+
+    int countHazardsFor(std::uint8_t elements, const CellRange& r) const {
+        return countTiles(HAZARD_TYPES[elements], r.col0, r.col1, r.row0, r.row1);
+    }
+
+    // swept AABB along x: returns the displacement `box` can actually make, stopping flush against
+    // the first column on the way that is solid for `elements`; only the columns between the old
+    // and the new leading edge are scanned
+    float sweepX(const sf::FloatRect& box, float dx, std::uint8_t elements, bool& blocked) const {
+        const float s = Tile::getSize();
+        const CellRange rows = cellsOverlapping(box);
+        blocked = false;
+        if (dx > 0.f) {
+            const float edge = box.left + box.width;
+            const int first = static_cast<int>(std::ceil((edge - EDGE_EPSILON) / s));
+            const int last = static_cast<int>(std::ceil((edge + dx) / s)) - 1;
+            for (int c = first; c <= last; ++c)
+                if (anySolidFor(elements, c, c, rows.row0, rows.row1)) { blocked = true; return c * s - edge; }
+        } else if (dx < 0.f) {
+            const float edge = box.left;
+            const int first = static_cast<int>(std::floor((edge + EDGE_EPSILON) / s)) - 1;
+            const int last = static_cast<int>(std::floor((edge + dx) / s));
+            for (int c = first; c >= last; --c)
+                if (anySolidFor(elements, c, c, rows.row0, rows.row1)) { blocked = true; return (c + 1) * s - edge; }
+        }
+        return dx;
+    }
+
+    // same as sweepX for the vertical axis
+    float sweepY(const sf::FloatRect& box, float dy, std::uint8_t elements, bool& blocked) const {
+        const float s = Tile::getSize();
+        const CellRange cols = cellsOverlapping(box);
+        blocked = false;
+        if (dy > 0.f) {
+            const float edge = box.top + box.height;
+            const int first = static_cast<int>(std::ceil((edge - EDGE_EPSILON) / s));
+            const int last = static_cast<int>(std::ceil((edge + dy) / s)) - 1;
+            for (int r = first; r <= last; ++r)
+                if (anySolidFor(elements, cols.col0, cols.col1, r, r)) { blocked = true; return r * s - edge; }
+        } else if (dy < 0.f) {
+            const float edge = box.top;
+            const int first = static_cast<int>(std::floor((edge + EDGE_EPSILON) / s)) - 1;
+            const int last = static_cast<int>(std::floor((edge + dy) / s));
+            for (int r = first; r >= last; --r)
+                if (anySolidFor(elements, cols.col0, cols.col1, r, r)) { blocked = true; return (r + 1) * s - edge; }
+        }
+        return dy;
+    }
+
+    // draw map: one batched draw call per non-empty chunk inside the target's view;
+    // chunks are streamed in and out around the view as it moves. Returns the draw calls issued
+    template <typename Target>
+    std::size_t draw(Target& target) const {
+        if (!renderer.isBuilt()) renderer.reset(width, height);
+        const sf::View& view = target.getView();
+        const sf::FloatRect area(view.getCenter() - view.getSize() / 2.f, view.getSize());
+        renderer.stream(area, cells);
+        return renderer.draw(target);
+    }
+
+    std::size_t residentChunks() const { return renderer.residentChunks(); }
+
+    friend std::ostream& operator<<(std::ostream& os, const Map& m) {
+        os << "Map " << m.width << "x" << m.height << "\n";
+        for (int r = 0; r < m.height; ++r) {
+            for (int c = 0; c < m.width; ++c) {
+                os << Tile(m.getTileTypeAtGrid(c, r), c, r);
+            }
+            os << "\n";
+        }
+        return os;
+    }
+
+    // get world bounds as rectangle
+    sf::FloatRect worldBounds() const {
+        return sf::FloatRect(0.f, 0.f, width * Tile::getSize(), height * Tile::getSize());
+    }
+
+    // find respawn positions for characters (grid col,row) -> world pos
+    sf::Vector2f respawnWorldPosForFire() const {
+        return sf::Vector2f(Tile::getSize() * fireSpawn.x, Tile::getSize() * fireSpawn.y);
+    }
+    sf::Vector2f respawnWorldPosForWater() const {
+        return sf::Vector2f(Tile::getSize() * waterSpawn.x, Tile::getSize() * waterSpawn.y);
+    }
+};
+
+// -------------------------------
+// TileAutomaton (liquids fall and pool, fire spreads through flammable tiles; awake regions only)
+// -------------------------------
+// The grid is split into REGION x REGION blocks and only awake blocks are stepped. A block falls
+// asleep once none of its cells can change and wakes when a cell within one tile of it changes
+// (no rule looks further), so a settled level costs nothing and the result is the same as
+// stepping every block. Blocks are stepped in four phases by the parity of their coordinates:
+// blocks of one phase are a whole block apart and never touch the same cell, so they can run
+// in parallel, with the same result on any number of threads. Cells move on a private copy of
+// the tiles; the changed ones are then written through Map::setTile, which keeps the bitboards
+// (collisions), the render chunks and the rewind journal current.
+class WorkStealingPool; // see the batch tools below
+
+class TileAutomaton {
+public:
+    static constexpr int REGION = 16; // tiles per block side
+
+private:
+    static constexpr std::uint8_t TYPE_MASK = 0x3F;
+    static constexpr std::uint8_t OCCUPIED = 0x40; // an empty cell a body stands in: liquids wait
+    static constexpr std::uint8_t MOVED = 0x80;    // written during this step: not stepped again
+
+    int width = 0, height = 0;
+    int regionsX = 0, regionsY = 0;
+    std::vector<std::uint8_t> grid; // tile codes plus the flags above
+    std::vector<std::uint8_t> awake, awakeNext; // per block
+    std::vector<std::vector<std::uint32_t>> written; // per block: cells written this step (capacity kept)
+    std::vector<std::uint32_t> phaseBlocks; // scratch
+    std::uint64_t syncedRevision = ~std::uint64_t{0}; // map revision `grid` mirrors
+    std::unique_ptr<WorkStealingPool> workers;
+    std::size_t lastStepped = 0;
+
+    static TileType typeOf(std::uint8_t v) { return static_cast<TileType>(v & TYPE_MASK); }
+    std::size_t index(int col, int row) const { return static_cast<std::size_t>(row) * width + col; }
+
+    // copy the map's tiles and wake every block (on the first step, and after tiles were
+    // written from outside: a level load, a rewind, a rollback)
+    void sync(const Map& map);
+    void wakeAround(std::vector<std::uint8_t>& blocks, int col, int row); // blocks within one tile of the cell
+    void stepBlock(std::size_t block, std::uint32_t stepIndex);
+
+public:
+    TileAutomaton();
+    ~TileAutomaton();
+    TileAutomaton(const TileAutomaton&) = delete;
+    TileAutomaton& operator=(const TileAutomaton&) = delete;
+
+    // 0 or 1: step every block on the calling thread
+    void setWorkers(unsigned threads);
+
+    // one step of the awake blocks (`stepIndex` drives the left/right preference and when fire
+    // catches); liquids do not flow into the empty cells `bodies` overlap. Returns tiles changed
+    std::size_t step(Map& map, std::uint32_t stepIndex, const std::vector<Map::CellRange>& bodies);
+
+    // blocks stepped last time, and blocks that will be stepped next time
+    std::size_t steppedBlocks() const { return lastStepped; }
+    std::size_t awakeBlocks() const { return static_cast<std::size_t>(std::count(awake.begin(), awake.end(), 1)); }
+    std::size_t blockCount() const { return awake.size(); }
+
+    // step every block next time (benchmarks compare this with the awake blocks alone)
+    void wakeAll() { std::fill(awake.begin(), awake.end(), std::uint8_t{1}); }
+};
+
+// -------------------------------
+// SpatialHash (uniform-grid broadphase: one cell per tile, hashed into buckets)
+// -------------------------------
+// Rebuilt from scratch every step with a counting sort, so there are no per-cell
+// allocations: entries of one bucket are contiguous in `entries`.
+class SpatialHash {
+private:
+    struct Entry {
+        std::uint32_t index;
+        std::int32_t col, row; // exact cell, to skip other cells that share the bucket
+    };
+
+    std::vector<std::uint32_t> bucketStart; // prefix sums, bucketCount + 1 values
+    std::vector<std::uint32_t> cursor;      // scratch for the fill pass
+    std::vector<Entry> entries;
+    std::size_t mask = 0;
+
+    std::size_t bucketOf(int col, int row) const {
+        return ((static_cast<std::uint32_t>(col) * 73856093u) ^ (static_cast<std::uint32_t>(row) * 19349663u)) & mask;
+    }
+
+public:
+    // rebuild from the cell range covered by each of the n items
+    void build(const std::vector<Map::CellRange>& ranges) {
+        std::size_t buckets = 64;
+        while (buckets < 2 * ranges.size()) buckets <<= 1;
+        mask = buckets - 1;
+        bucketStart.assign(buckets + 1, 0);
+        for (const Map::CellRange& cr : ranges)
+            for (int r = cr.row0; r <= cr.row1; ++r)
+                for (int c = cr.col0; c <= cr.col1; ++c)
+                    ++bucketStart[bucketOf(c, r) + 1];
+        for (std::size_t b = 0; b < buckets; ++b) bucketStart[b + 1] += bucketStart[b];
+
+        entries.resize(bucketStart[buckets]);
+        cursor.assign(bucketStart.begin(), bucketStart.end() - 1);
+        for (std::size_t i = 0; i < ranges.size(); ++i) {
+            const Map::CellRange& cr = ranges[i];
+            for (int r = cr.row0; r <= cr.row1; ++r)
+                for (int c = cr.col0; c <= cr.col1; ++c)
+                    entries[cursor[bucketOf(c, r)]++] = {static_cast<std::uint32_t>(i), c, r};
+        }
+    }
+
+    // call fn(index) for every item registered in cell (col,row)
+    template <typename Fn>
+    void forEachInCell(int col, int row, Fn&& fn) const {
+        const std::size_t b = bucketOf(col, row);
+        for (std::uint32_t k = bucketStart[b]; k < bucketStart[b + 1]; ++k)
+            if (entries[k].col == col && entries[k].row == row) fn(entries[k].index);
+    }
+};
+
+// FNV-1a over raw bytes; used to compare simulation end states bit for bit
+inline std::uint64_t hashBytes(std::uint64_t h, const void* data, std::size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// -------------------------------
+// EntityWorld (dynamic bodies: boxes, moving platforms, walkers)
+// -------------------------------
+enum class EntityKind : std::uint8_t { Box, MovingPlatform, Walker };
+
+class EntityWorld {
+private:
+    static constexpr float GRAVITY = 900.f;
+
+    // structure of arrays: entity i is element i of every array, so each pass
+    // only streams through the fields it needs
+    std::vector<float> posX, posY, velX, velY, width, height;
+    std::vector<EntityKind> kinds;
+    std::vector<Map::CellRange> cells; // cells covered at the last broadphase build
+
+    SpatialHash broadphase;
+    std::size_t candidatePairs = 0; // narrowphase tests during the last step
+    mutable sf::VertexArray vertices{sf::Triangles};
+
+    static bool pushable(EntityKind k) { return k == EntityKind::Box; }
+    static bool hasGravity(EntityKind k) { return k != EntityKind::MovingPlatform; }
+
+    sf::FloatRect box(std::size_t i) const { return {posX[i], posY[i], width[i], height[i]}; }
+
+    // move entity i by (dx,dy) through the tile grid (entities treat every element's solids as solid)
+    void moveThroughTiles(std::size_t i, float dx, float dy, const Map& map, bool& blockedX, bool& blockedY) {
+        posX[i] += map.sweepX(box(i), dx, ALL_ELEMENTS, blockedX);
+        posY[i] += map.sweepY(box(i), dy, ALL_ELEMENTS, blockedY);
+    }
+
+    void integrate(std::size_t i, float dt, const Map& map) {
+        if (hasGravity(kinds[i])) velY[i] += GRAVITY * dt;
+        bool blockedX = false, blockedY = false;
+        moveThroughTiles(i, velX[i] * dt, velY[i] * dt, map, blockedX, blockedY);
+        // platforms and walkers turn around at walls, boxes just stop
+        if (blockedX) velX[i] = (kinds[i] == EntityKind::Box) ? 0.f : -velX[i];
+        if (blockedY) velY[i] = (kinds[i] == EntityKind::MovingPlatform) ? -velY[i] : 0.f;
+    }
+
+    // separate two overlapping entities along the axis of least penetration;
+    // only pushable entities move (half each when both are pushable)
+    void resolvePair(std::size_t a, std::size_t b, const Map& map) {
+        const float ox = std::min(posX[a] + width[a], posX[b] + width[b]) - std::max(posX[a], posX[b]);
+        const float oy = std::min(posY[a] + height[a], posY[b] + height[b]) - std::max(posY[a], posY[b]);
+        if (ox <= 0.f || oy <= 0.f) return;
+        const bool pa = pushable(kinds[a]), pb = pushable(kinds[b]);
+        if (!pa && !pb) return;
+        const float wa = pa ? (pb ? 0.5f : 1.f) : 0.f;
+        const float wb = 1.f - wa;
+        bool blockedX = false, blockedY = false;
+        if (ox < oy) {
+            const float dir = (posX[a] < posX[b]) ? -1.f : 1.f;
+            if (wa > 0.f) moveThroughTiles(a, dir * ox * wa, 0.f, map, blockedX, blockedY);
+            if (wb > 0.f) moveThroughTiles(b, -dir * ox * wb, 0.f, map, blockedX, blockedY);
+        } else {
+            const float dir = (posY[a] < posY[b]) ? -1.f : 1.f;
+            if (wa > 0.f) moveThroughTiles(a, 0.f, dir * oy * wa, map, blockedX, blockedY);
+            if (wb > 0.f) moveThroughTiles(b, 0.f, -dir * oy * wb, map, blockedX, blockedY);
+            // the upper one rests on the lower one
+            const std::size_t upper = (dir < 0.f) ? a : b;
+            if (pushable(kinds[upper]) && velY[upper] > 0.f) velY[upper] = 0.f;
+        }
+    }
+
+public:
+    std::size_t spawn(EntityKind kind, const sf::Vector2f& pos, const sf::Vector2f& size, const sf::Vector2f& vel = {0.f, 0.f}) {
+        posX.push_back(pos.x); posY.push_back(pos.y);
+        velX.push_back(vel.x); velY.push_back(vel.y);
+        width.push_back(size.x); height.push_back(size.y);
+        kinds.push_back(kind);
+        return kinds.size() - 1;
+    }
+
+    std::size_t size() const { return kinds.size(); }
+    std::size_t lastCandidatePairs() const { return candidatePairs; }
+
+    // append the cells every entity covers now (e.g. the bodies liquids must not flow into)
+    void appendCells(std::vector<Map::CellRange>& out) const {
+        for (std::size_t i = 0; i < size(); ++i) out.push_back(Map::cellsOverlapping(box(i)));
+    }
+
+    // positions and velocities as raw floats (array by array, so resting entities compress well);
+    // sizes and kinds never change, the broadphase is rebuilt by the next step
+    std::size_t stateBytes() const { return size() * 4 * sizeof(float); }
+
+    void saveState(std::uint8_t* out) const {
+        for (const std::vector<float>* a : {&posX, &posY, &velX, &velY}) {
+            if (a->empty()) continue;
+            std::memcpy(out, a->data(), a->size() * sizeof(float));
+            out += a->size() * sizeof(float);
+        }
+    }
+
+    // fold the simulated state (what saveState writes) into a hash
+    std::uint64_t stateHash(std::uint64_t h) const {
+        for (const std::vector<float>* a : {&posX, &posY, &velX, &velY}) h = hashBytes(h, a->data(), a->size() * sizeof(float));
+        return h;
+    }
+
+    void loadState(const std::uint8_t* in) {
+        for (std::vector<float>* a : {&posX, &posY, &velX, &velY}) {
+            if (a->empty()) continue;
+            std::memcpy(a->data(), in, a->size() * sizeof(float));
+            in += a->size() * sizeof(float);
+        }
+    }
+
+    // one simulation step: integrate against tiles, rebuild the broadphase,
+    // then run the narrowphase only on pairs that share a cell
+    void step(float dt, const Map& map) {
+        const std::size_t n = size();
+        for (std::size_t i = 0; i < n; ++i) integrate(i, dt, map);
+
+        cells.resize(n);
+        for (std::size_t i = 0; i < n; ++i) cells[i] = Map::cellsOverlapping(box(i));
+        broadphase.build(cells);
+
+        candidatePairs = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const Map::CellRange ci = cells[i];
+            for (int r = ci.row0; r <= ci.row1; ++r) {
+                for (int c = ci.col0; c <= ci.col1; ++c) {
+                    broadphase.forEachInCell(c, r, [&](std::uint32_t j) {
+                        if (j <= i) return;
+                        // a pair sharing several cells is tested only in the first shared one
+                        const Map::CellRange& cj = cells[j];
+                        if (c != std::max(ci.col0, cj.col0) || r != std::max(ci.row0, cj.row0)) return;
+                        ++candidatePairs;
+                        resolvePair(i, j, map);
+                    });
+                }
+            }
+        }
+    }
+
+    // push a character-sized body out of the entities it overlaps: boxes in the way are
+    // shoved sideways (as far as the tiles let them), everything else is solid.
+    // Returns the correction to apply to the body.
+    sf::Vector2f collideBody(const sf::FloatRect& body, const Map& map) {
+        sf::Vector2f correction(0.f, 0.f);
+        if (kinds.empty()) return correction;
+        const Map::CellRange cr = Map::cellsOverlapping(body);
+        for (int r = cr.row0; r <= cr.row1; ++r) {
+            for (int c = cr.col0; c <= cr.col1; ++c) {
+                broadphase.forEachInCell(c, r, [&](std::uint32_t i) {
+                    const float bx = body.left + correction.x, by = body.top + correction.y;
+                    const float ox = std::min(bx + body.width, posX[i] + width[i]) - std::max(bx, posX[i]);
+                    const float oy = std::min(by + body.height, posY[i] + height[i]) - std::max(by, posY[i]);
+                    if (ox <= 0.f || oy <= 0.f) return;
+                    if (ox < oy) {
+                        const float dir = (bx < posX[i]) ? -1.f : 1.f;
+                        float moved = 0.f;
+                        if (pushable(kinds[i])) {
+                            bool blocked = false;
+                            moved = map.sweepX(box(i), -dir * ox, ALL_ELEMENTS, blocked);
+                            posX[i] += moved;
+                        }
+                        correction.x += dir * (ox - std::abs(moved));
+                    } else {
+                        correction.y += (by < posY[i]) ? -oy : oy;
+                    }
+                });
+            }
+        }
+        return correction;
+    }
+
+    // all entities in a single draw call (returns the number of draw calls: 0 or 1)
+    template <typename Target>
+    std::size_t draw(Target& target) const {
+        if (kinds.empty()) return 0;
+        vertices.resize(kinds.size() * 6);
+        for (std::size_t i = 0; i < kinds.size(); ++i) {
+            const float x0 = posX[i], y0 = posY[i], x1 = x0 + width[i], y1 = y0 + height[i];
+            const sf::Color color = (kinds[i] == EntityKind::Box) ? sf::Color(150, 100, 50)
+                                  : (kinds[i] == EntityKind::MovingPlatform) ? sf::Color(170, 170, 200)
+                                  : sf::Color(200, 60, 200);
+            const sf::Vector2f corners[6] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y0}, {x1, y1}, {x0, y1}};
+            for (std::size_t k = 0; k < 6; ++k) vertices[i * 6 + k] = sf::Vertex(corners[k], color);
+        }
+        target.draw(vertices);
+        return 1;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const EntityWorld& w) {
+        os << "EntityWorld: " << w.size() << " entities, " << w.candidatePairs << " candidate pairs";
+        return os;
+    }
+};
+
+// -------------------------------
+// AssetCache (assets shared by path, decoded at most once per process, optionally in the background)
+// -------------------------------
+// A Loader describes one asset kind: decode() runs on a background thread (file I/O and
+// decompression), finish() runs on the thread that acquires the asset (e.g. a GPU upload,
+// which needs the window's GL context).
+// Images stay in memory as decoded pixels: they are packed into a TextureAtlas, which uploads
+// whole pages at once.
+struct ImageLoader {
+    using Source = sf::Image;
+    using Asset = sf::Image;
+    static bool decode(const std::string& path, sf::Image& img) { return img.loadFromFile(path); }
+    static bool finish(const sf::Image& src, sf::Image& img) { img = src; return img.getSize().x > 0; }
+};
+
+struct FontLoader {
+    using Source = sf::Font;
+    using Asset = sf::Font;
+    static bool decode(const std::string& path, sf::Font& font) { return font.loadFromFile(path); }
+    static bool finish(const sf::Font& src, sf::Font& font) { font = src; return true; }
+};
+
+template <typename Loader>
+class AssetCache {
+private:
+    using Source = typename Loader::Source;
+    using Asset = typename Loader::Asset;
+
+    std::mutex mtx;
+    // failed loads are cached too (as nullptr) so a missing file is not retried per user
+    std::unordered_map<std::string, std::shared_ptr<const Asset>> ready;
+    std::unordered_map<std::string, std::future<std::unique_ptr<Source>>> pending;
+
+    AssetCache() = default;
+
+    static std::unique_ptr<Source> decodeFile(const std::string& path) {
+        auto src = std::make_unique<Source>();
+        if (!Loader::decode(path, *src)) src.reset();
+        return src;
+    }
+
+    // turn a decoded source into the shared asset (caller holds the lock)
+    std::shared_ptr<const Asset> finishLocked(const std::string& path, std::unique_ptr<Source> src) {
+        std::shared_ptr<const Asset> handle;
+        if (src) {
+            auto asset = std::make_shared<Asset>();
+            if (Loader::finish(*src, *asset)) handle = std::move(asset);
+        }
+        ready[path] = handle;
+        return handle;
+    }
+
+    void prefetchLocked(const std::string& path) {
+        if (ready.contains(path) || pending.contains(path)) return;
+        pending.emplace(path, std::async(std::launch::async, decodeFile, path));
+    }
+
+public:
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    static AssetCache& instance() {
+        static AssetCache cache;
+        return cache;
+    }
+
+    // start decoding `path` on a background thread (no-op if already requested)
+    void prefetch(const std::string& path) {
+        std::lock_guard lock(mtx);
+        prefetchLocked(path);
+    }
+
+    // non-blocking: std::nullopt while the asset is still loading (the load is started if needed),
+    // otherwise the asset, or nullptr if it could not be loaded
+    std::optional<std::shared_ptr<const Asset>> tryAcquire(const std::string& path) {
+        std::lock_guard lock(mtx);
+        if (auto it = ready.find(path); it != ready.end()) return it->second;
+        auto it = pending.find(path);
+        if (it == pending.end()) {
+            prefetchLocked(path);
+            return std::nullopt;
+        }
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return std::nullopt;
+        std::unique_ptr<Source> src = it->second.get();
+        pending.erase(it);
+        return finishLocked(path, std::move(src));
+    }
+
+    // blocking: the asset, or nullptr if it cannot be loaded
+    std::shared_ptr<const Asset> acquire(const std::string& path) {
+        std::lock_guard lock(mtx);
+        if (auto it = ready.find(path); it != ready.end()) return it->second;
+        std::unique_ptr<Source> src;
+        if (auto it = pending.find(path); it != pending.end()) {
+            src = it->second.get();
+            pending.erase(it);
+        } else {
+            src = decodeFile(path);
+        }
+        return finishLocked(path, std::move(src));
+    }
+
+    // drop assets nobody holds a handle to any more
+    void releaseUnused() {
+        std::lock_guard lock(mtx);
+        std::erase_if(ready, [](const auto& kv) { return kv.second && kv.second.use_count() == 1; });
+    }
+};
+
+using ImageCache = AssetCache<ImageLoader>;
+using FontCache = AssetCache<FontLoader>;
+
+// -------------------------------
+// TextureAtlas (every sprite and tile image packed into a few large textures)
+// -------------------------------
+// Images are packed on shelves, tallest first, into pages of PAGE_SIZE pixels; each image gets
+// a one pixel border copied from its own edge, so filtering never samples a neighbour. An image
+// N times as wide as it is high is a strip of N square animation frames.
+struct AtlasFrame {
+    std::uint32_t page = 0;
+    sf::FloatRect rect; // texture coordinates, in pixels
+};
+
+class TextureAtlas {
+public:
+    static constexpr unsigned PAGE_SIZE = 1024;
+    static constexpr const char* WHITE = "white"; // one opaque pixel: tinted, it draws plain colors
+
+    // the frames of one image; the animation advances by one frame every `stepsPerFrame` steps
+    struct Animation {
+        std::vector<AtlasFrame> frames;
+        std::uint32_t stepsPerFrame = 1;
+        sf::Vector2f frameSize; // pixels
+
+        const AtlasFrame& at(std::uint64_t tick) const { return frames[(tick / stepsPerFrame) % frames.size()]; }
+    };
+
+private:
+    static constexpr unsigned PADDING = 1;
+
+    struct Source {
+        std::string name;
+        sf::Image image;
+        std::uint32_t stepsPerFrame;
+    };
+    std::vector<Source> sources;
+    unsigned pageSize;
+    std::vector<sf::Image> pageImages;
+    std::vector<std::unique_ptr<sf::Texture>> pageTextures; // empty when there is no GL context to upload to
+    std::unordered_map<std::string, Animation> animations;
+
+public:
+    explicit TextureAtlas(unsigned pageSide = PAGE_SIZE)
+        : pageSize(std::min(pageSide, sf::Texture::getMaximumSize())) {}
+
+    // queue an image under `name` (replacing one queued before); nothing is packed until build()
+    void add(const std::string& name, const sf::Image& image, std::uint32_t stepsPerFrame = 1) {
+        std::erase_if(sources, [&](const Source& src) { return src.name == name; });
+        sources.push_back({name, image, std::max<std::uint32_t>(stepsPerFrame, 1)});
+    }
+
+    // pack every queued image (plus WHITE) into pages and upload them when `upload` is set;
+    // returns false if an image was too large for a page (it is left out)
+    bool build(bool upload = true);
+
+    const Animation* find(const std::string& name) const {
+        auto it = animations.find(name);
+        return it == animations.end() ? nullptr : &it->second;
+    }
+
+    std::size_t pageCount() const { return pageImages.size(); }
+    const sf::Image& pageImage(std::size_t page) const { return pageImages[page]; }
+    const sf::Texture* pageTexture(std::size_t page) const {
+        return page < pageTextures.size() ? pageTextures[page].get() : nullptr;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const TextureAtlas& a) {
+        os << "TextureAtlas: " << a.animations.size() << " images on " << a.pageImages.size() << " page(s)";
+        for (const sf::Image& page : a.pageImages) os << " " << page.getSize().x << "x" << page.getSize().y;
+        return os;
+    }
+};
+
+// -------------------------------
+// SpriteBatch (every sprite of a frame in one vertex array per atlas page)
+// -------------------------------
+class SpriteBatch {
+private:
+    const TextureAtlas* atlas = nullptr;
+    std::vector<sf::VertexArray> pages; // kept between frames, so their storage is reused
+    std::size_t sprites = 0;
+
+public:
+    void begin(const TextureAtlas& a) {
+        atlas = &a;
+        if (pages.size() < a.pageCount()) pages.resize(a.pageCount(), sf::VertexArray(sf::Triangles));
+        for (sf::VertexArray& v : pages) v.clear();
+        sprites = 0;
+    }
+
+    // `frame` stretched over `dest` (world coordinates), multiplied by `tint`
+    void add(const AtlasFrame& frame, const sf::FloatRect& dest, const sf::Color& tint = sf::Color::White) {
+        sf::VertexArray& v = pages[frame.page];
+        const sf::FloatRect& t = frame.rect;
+        const float x0 = dest.left, y0 = dest.top, x1 = dest.left + dest.width, y1 = dest.top + dest.height;
+        const float u0 = t.left, v0 = t.top, u1 = t.left + t.width, v1 = t.top + t.height;
+        v.append(sf::Vertex({x0, y0}, tint, {u0, v0}));
+        v.append(sf::Vertex({x1, y0}, tint, {u1, v0}));
+        v.append(sf::Vertex({x1, y1}, tint, {u1, v1}));
+        v.append(sf::Vertex({x0, y0}, tint, {u0, v0}));
+        v.append(sf::Vertex({x1, y1}, tint, {u1, v1}));
+        v.append(sf::Vertex({x0, y1}, tint, {u0, v1}));
+        ++sprites;
+    }
+
+    std::size_t size() const { return sprites; }
+
+    // one draw call per page that has sprites; returns the number of draw calls
+    // (a SoftwareRenderer samples the page images instead of the uploaded textures)
+    template <typename Target>
+    std::size_t draw(Target& target) const {
+        std::size_t calls = 0;
+        for (std::size_t p = 0; p < pages.size(); ++p) {
+            if (pages[p].getVertexCount() == 0) continue;
+            if constexpr (std::is_base_of_v<sf::RenderTarget, Target>) {
+                sf::RenderStates states;
+                states.texture = atlas->pageTexture(p);
+                target.draw(pages[p], states);
+            } else {
+                target.draw(pages[p], &atlas->pageImage(p));
+            }
+            ++calls;
+        }
+        return calls;
+    }
+};
+
+// -------------------------------
+// ParticleSystem (flames, splashes and death bursts: structure of arrays, one vertex array per frame)
+// -------------------------------
+// Every attribute is an array of its own, allocated once for `capacity` particles: the update
+// is a few straight float loops (left for the compiler to vectorize) and spawning never
+// allocates; spawns beyond capacity are dropped. Dead particles are replaced by the last live
+// one, then every live one becomes a plain-color quad (six vertices) of a single Triangles
+// array. With workers, the integration and the vertex build run in chunks on a WorkStealingPool.
+
+// how the particles of one emit() start: each value is drawn uniformly between its bounds
+struct ParticleStyle {
+    sf::Vector2f minVelocity, maxVelocity; // px/s
+    float accelerationY;                   // px/s^2: gravity for drops, negative for flames that rise
+    float minLife, maxLife;                // seconds; a particle fades out over its life
+    float size;                            // side of the square, px
+    sf::Color fromColor, toColor;          // every particle gets a random mix of the two
+};
+
+class ParticleSystem {
+private:
+    std::size_t capacity;
+    std::size_t count = 0;
+    std::size_t peak = 0;
+    std::vector<float> px, py, vx, vy, ay;
+    std::vector<float> life; // seconds left; <= 0 is dead (removed by the next update)
+    std::vector<float> fade; // 1 / starting life, so life * fade is the opacity
+    std::vector<float> side;
+    std::vector<sf::Color> color;
+    sf::VertexArray vertices{sf::Triangles}; // kept between frames, so its storage is reused
+    std::unique_ptr<WorkStealingPool> workers;
+    std::uint32_t rng = 0x9E3779B9u; // xorshift32: cheap, and seeded, so captures are reproducible
+
+    float random01() {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return static_cast<float>(rng >> 8) * (1.f / 16777216.f);
+    }
+    float randomBetween(float lo, float hi) { return lo + (hi - lo) * random01(); }
+
+    void compact();
+    void advance(std::size_t begin, std::size_t end, float dt); // integrate + build the quads of [begin, end)
+
+public:
+    // below this many particles per worker, handing out a chunk costs more than updating it
+    static constexpr std::size_t MIN_CHUNK = 16384;
+
+    explicit ParticleSystem(std::size_t maxParticles);
+    ~ParticleSystem();
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    // 0 or 1: update on the calling thread
+    void setWorkers(unsigned threads);
+
+    // spawn `expected` particles of `style` at random spots of `area` (world coordinates); the
+    // fraction is rounded up or down at random, so a rate times the frame time averages out.
+    // Returns the number spawned
+    std::size_t emit(const ParticleStyle& style, const sf::FloatRect& area, float expected);
+
+    // drop the dead, move the rest by `dt` seconds and rebuild the vertex array
+    void update(float dt);
+
+    void clear() {
+        count = 0;
+        vertices.clear();
+    }
+
+    std::size_t size() const { return count; }
+    std::size_t maxSize() const { return capacity; }
+    std::size_t peakSize() const { return peak; }
+
+    // one draw call (none while empty); returns the number of draw calls
+    template <typename Target>
+    std::size_t draw(Target& target) const {
+        if (vertices.getVertexCount() == 0) return 0;
+        target.draw(vertices);
+        return 1;
+    }
+};
+
+// -------------------------------
+// SoftwareRenderer (CPU rasterizer into an in-memory RGBA framebuffer, no GPU or display needed)
+// -------------------------------
+// Draws the same vertex arrays as the window: every six vertices of a Triangles array are one
+// axis-aligned quad (corners 0 and 2 opposite), which is what the map chunks, the entities,
+// the sprite batch and the particles produce. A quad becomes one span per row: a plain color
+// is a fill of 32-bit pixels, a texture is sampled nearest-neighbour through a per-quad column
+// table, and a destination row whose source row and pixels equal the row above is copied from
+// it. The inner loops are plain array loops, left for the compiler to vectorize.
+class SoftwareRenderer {
+private:
+    unsigned width, height;
+    std::vector<std::uint32_t> pixels; // RGBA bytes in memory order, like sf::Image
+    sf::View defaultView, view;
+    std::vector<std::uint32_t> columns; // scratch: source column of every destination pixel of a span
+    std::size_t quads = 0;
+
+    static std::uint32_t pack(const sf::Color& c) {
+        const std::uint8_t bytes[4] = {c.r, c.g, c.b, c.a};
+        std::uint32_t v;
+        std::memcpy(&v, bytes, sizeof(v));
+        return v;
+    }
+
+    void fillRect(int x0, int y0, int x1, int y1, const sf::Color& color);
+    void blitRect(int x0, int y0, int x1, int y1, float u0, float v0, float dudx, float dvdy,
+                  const sf::Image& texture, const sf::Color& tint);
+
+public:
+    SoftwareRenderer(unsigned w, unsigned h)
+        : width(w), height(h), pixels(static_cast<std::size_t>(w) * h, 0),
+          defaultView(sf::FloatRect(0.f, 0.f, static_cast<float>(w), static_cast<float>(h))), view(defaultView) {}
+
+    // the part of sf::RenderTarget the engine's draw functions use
+    sf::Vector2u getSize() const { return {width, height}; }
+    const sf::View& getView() const { return view; }
+    const sf::View& getDefaultView() const { return defaultView; }
+    void setView(const sf::View& v) { view = v; }
+    void clear(const sf::Color& color) {
+        std::fill(pixels.begin(), pixels.end(), pack(color));
+    }
+    void draw(const sf::VertexArray& vertices, const sf::Image* texture = nullptr);
+
+    std::size_t quadsDrawn() const { return quads; }
+    const std::uint8_t* data() const { return reinterpret_cast<const std::uint8_t*>(pixels.data()); }
+    sf::Image toImage() const;
+
+    // .ppm is written (and read) here; other extensions (.png, ...) go through sf::Image
+    bool saveToFile(const std::string& path) const;
+    static bool loadImage(const std::string& path, sf::Image& out);
+
+    // golden-image check: pixels whose channels differ from `golden` by more than `tolerance`
+    struct Difference {
+        bool sameSize = false;
+        std::size_t pixels = 0;
+        unsigned maxDelta = 0;
+    };
+    Difference compare(const sf::Image& golden, unsigned tolerance = 0) const;
+};
+
+// -------------------------------
+// FrameProfiler (scoped phase timers -> lock-free ring buffer -> Chrome trace JSON)
+// -------------------------------
+// Any thread can record: a slot is claimed with one fetch_add and published with a sequence
+// number, so the exporter skips slots that are being overwritten instead of locking writers.
+// While disabled a ProfileScope costs one relaxed atomic load.
+class FrameProfiler {
+private:
+    static constexpr std::size_t CAPACITY = 1 << 16; // events kept (older ones are overwritten)
+    static constexpr std::size_t FRAME_HISTORY = 600; // frame times kept for the percentiles
+
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0}; // index + 1 once published, 0 while being written
+        std::atomic<const char*> name{nullptr};
+        std::atomic<std::int64_t> beginNs{0}, endNs{0};
+        std::atomic<std::uint32_t> thread{0};
+    };
+
+    inline static std::atomic<bool> active{false};
+
+    std::vector<Slot> ring;
+    std::atomic<std::uint64_t> head{0};
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    // frame statistics (written by the thread that ends frames)
+    std::vector<float> frameMs;
+    std::size_t framesSeen = 0;
+    std::size_t lastDrawCalls = 0;
+
+    FrameProfiler() : ring(CAPACITY), frameMs(FRAME_HISTORY, 0.f) {}
+
+    static std::uint32_t threadId() {
+        static std::atomic<std::uint32_t> next{1};
+        thread_local const std::uint32_t id = next.fetch_add(1);
+        return id;
+    }
+
+public:
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    static FrameProfiler& instance() {
+        static FrameProfiler profiler;
+        return profiler;
+    }
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on) { active.store(on, std::memory_order_relaxed); }
+
+    std::int64_t nowNs() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // `name` must outlive the profiler (string literals)
+    void record(const char* name, std::int64_t beginNs, std::int64_t endNs) {
+        const std::uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = ring[index & (CAPACITY - 1)];
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.beginNs.store(beginNs, std::memory_order_relaxed);
+        slot.endNs.store(endNs, std::memory_order_relaxed);
+        slot.thread.store(threadId(), std::memory_order_relaxed);
+        slot.seq.store(index + 1, std::memory_order_release);
+    }
+
+    void endFrame(float ms, std::size_t drawCalls) {
+        frameMs[framesSeen % FRAME_HISTORY] = ms;
+        ++framesSeen;
+        lastDrawCalls = drawCalls;
+    }
+
+    std::size_t drawCalls() const { return lastDrawCalls; }
+
+    // frame time percentile over the recent frames (p in 0..1)
+    float framePercentile(double p) const {
+        const std::size_t n = std::min(framesSeen, FRAME_HISTORY);
+        if (n == 0) return 0.f;
+        std::vector<float> sorted(frameMs.begin(), frameMs.begin() + static_cast<std::ptrdiff_t>(n));
+        const std::size_t k = std::min(n - 1, static_cast<std::size_t>(p * static_cast<double>(n - 1) + 0.5));
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(k), sorted.end());
+        return sorted[k];
+    }
+
+    // write the buffered events as a Chrome trace (load in chrome://tracing or Perfetto)
+    bool exportChromeTrace(const std::string& path) const;
+};
+
+// times the enclosing block as one trace event (nothing is read or written while disabled)
+class ProfileScope {
+private:
+    const char* name;
+    std::int64_t beginNs = -1;
+
+public:
+    explicit ProfileScope(const char* phase) : name(phase) {
+        if (FrameProfiler::enabled()) [[unlikely]] beginNs = FrameProfiler::instance().nowNs();
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ~ProfileScope() {
+        if (beginNs >= 0) [[unlikely]] {
+            FrameProfiler& p = FrameProfiler::instance();
+            p.record(name, beginNs, p.nowNs());
+        }
+    }
+};
+
+// on-screen frame statistics (text is rebuilt a few times per second, not every frame)
+class ProfilerOverlay {
+private:
+    static constexpr float REFRESH_SECONDS = 0.25f;
+
+    std::string fontPath;
+    std::shared_ptr<const sf::Font> font;
+    sf::Text text;
+    float sinceRefresh = REFRESH_SECONDS;
+    bool visible = true;
+
+public:
+    explicit ProfilerOverlay(const std::string& fontFile) : fontPath(fontFile) {
+        text.setCharacterSize(14);
+        text.setFillColor(sf::Color::White);
+        text.setPosition(6.f, 4.f);
+    }
+
+    void toggle() { visible = !visible; }
+    bool isVisible() const { return visible && font; }
+
+    void update(float frameSeconds) {
+        if (!font && !fontPath.empty()) {
+            auto loaded = FontCache::instance().tryAcquire(fontPath);
+            if (loaded) {
+                fontPath.clear();
+                font = std::move(*loaded);
+                if (font) text.setFont(*font);
+            }
+        }
+        sinceRefresh += frameSeconds;
+        if (!font || sinceRefresh < REFRESH_SECONDS) return;
+        sinceRefresh = 0.f;
+        const FrameProfiler& p = FrameProfiler::instance();
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(2) << "frame ms p50 " << p.framePercentile(0.50) << "  p95 "
+           << p.framePercentile(0.95) << "  p99 " << p.framePercentile(0.99) << "\ndraw calls " << p.drawCalls();
+        text.setString(os.str());
+    }
+
+    // drawn in screen space; returns the number of draw calls
+    std::size_t draw(sf::RenderTarget& target) const {
+        if (!isVisible()) return 0;
+        const sf::View world = target.getView();
+        target.setView(target.getDefaultView());
+        target.draw(text);
+        target.setView(world);
+        return 1;
+    }
+};
+
+// -------------------------------
+// Hud (lives, elapsed time and FPS as cached glyph quads)
+// -------------------------------
+// Every printable ASCII glyph is rendered into the font's texture once, when the font arrives;
+// from then on the texture never changes and a label is a list of quads pointing into it.
+// A label's quads are rebuilt only when its text changes (values are compared as numbers
+// first, so no string is formatted on frames where nothing changed), and all labels are drawn
+// with a single call in screen space, top right.
+class Hud {
+private:
+    static constexpr unsigned CHARACTER_SIZE = 18;
+    static constexpr char FIRST_GLYPH = ' ', LAST_GLYPH = '~';
+    static constexpr float MARGIN = 8.f;
+    static constexpr float FPS_WINDOW_SECONDS = 0.5f; // FPS is averaged over (and updated every) half second
+
+    enum LabelId { FireLives, WaterLives, Time, Fps, LABEL_COUNT };
+    struct Label {
+        std::string text;
+        sf::Color color;
+        std::vector<sf::Vertex> quads; // laid out from the origin (right edge, top)
+    };
+
+    std::string fontPath;
+    std::shared_ptr<const sf::Font> font;
+    std::array<sf::Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs{};
+    float lineSpacing = 0.f;
+    std::array<Label, LABEL_COUNT> labels;
+    sf::VertexArray vertices{sf::Triangles}; // every label, at its place on screen
+    float laidOutWidth = -1.f; // target width the vertices were placed for
+    bool dirty = true;
+    bool visible = true;
+
+    // displayed values (-1: nothing shown yet)
+    int fireLives = -1, waterLives = -1;
+    long tenths = -1;
+    int fpsShown = -1;
+    float fpsSeconds = 0.f;
+    int fpsFrames = 0;
+    std::size_t rebuilds = 0;
+
+    void bake() {
+        for (char c = FIRST_GLYPH; c <= LAST_GLYPH; ++c)
+            glyphs[static_cast<std::size_t>(c - FIRST_GLYPH)] = font->getGlyph(static_cast<sf::Uint32>(c), CHARACTER_SIZE, false);
+        lineSpacing = font->getLineSpacing(CHARACTER_SIZE);
+    }
+
+    // quads of `text`, right-aligned on x = 0, with a dark copy one pixel down-right as a shadow
+    void layout(Label& label) const {
+        ProfileScope scope("Hud::layout");
+        float width = 0.f;
+        for (char c : label.text)
+            if (c >= FIRST_GLYPH && c <= LAST_GLYPH) width += glyphs[static_cast<std::size_t>(c - FIRST_GLYPH)].advance;
+        label.quads.clear();
+        for (const auto& [offset, color] : {std::pair{1.f, sf::Color(0, 0, 0, 180)}, std::pair{0.f, label.color}}) {
+            float x = -width;
+            for (char c : label.text) {
+                if (c < FIRST_GLYPH || c > LAST_GLYPH) continue;
+                const sf::Glyph& g = glyphs[static_cast<std::size_t>(c - FIRST_GLYPH)];
+                const float x0 = x + g.bounds.left + offset, y0 = CHARACTER_SIZE + g.bounds.top + offset;
+                const float x1 = x0 + g.bounds.width, y1 = y0 + g.bounds.height;
+                const sf::IntRect& t = g.textureRect;
+                const float u0 = static_cast<float>(t.left), v0 = static_cast<float>(t.top);
+                const float u1 = u0 + static_cast<float>(t.width), v1 = v0 + static_cast<float>(t.height);
+                if (g.bounds.width > 0.f) {
+                    const sf::Vertex corners[6] = {{{x0, y0}, color, {u0, v0}}, {{x1, y0}, color, {u1, v0}}, {{x1, y1}, color, {u1, v1}},
+                                                   {{x0, y0}, color, {u0, v0}}, {{x1, y1}, color, {u1, v1}}, {{x0, y1}, color, {u0, v1}}};
+                    label.quads.insert(label.quads.end(), corners, corners + 6);
+                }
+                x += g.advance;
+            }
+        }
+    }
+
+    void setText(LabelId id, std::string text) {
+        Label& label = labels[id];
+        label.text = std::move(text);
+        if (font) layout(label);
+        dirty = true;
+        ++rebuilds;
+    }
+
+public:
+    explicit Hud(const std::string& fontFile) : fontPath(fontFile) {
+        labels[FireLives].color = sf::Color(255, 120, 80);
+        labels[WaterLives].color = sf::Color(110, 170, 255);
+        labels[Time].color = labels[Fps].color = sf::Color(235, 235, 235);
+    }
+
+    void toggle() { visible = !visible; }
+
+    // once per rendered frame, with its duration
+    void countFrame(float seconds) {
+        fpsSeconds += seconds;
+        ++fpsFrames;
+        if (fpsSeconds < FPS_WINDOW_SECONDS) return;
+        const int fps = static_cast<int>(std::lround(static_cast<float>(fpsFrames) / fpsSeconds));
+        fpsSeconds = 0.f;
+        fpsFrames = 0;
+        if (fps != fpsShown) {
+            fpsShown = fps;
+            setText(Fps, "FPS " + std::to_string(fps));
+        }
+    }
+
+    // the simulated values to show; labels whose value did not change are left alone
+    void update(int fireboyLives, int watergirlLives, float elapsedSeconds) {
+        if (!font && !fontPath.empty()) {
+            auto loaded = FontCache::instance().tryAcquire(fontPath);
+            if (loaded) {
+                fontPath.clear();
+                font = std::move(*loaded);
+                if (font) {
+                    bake();
+                    for (Label& label : labels) layout(label);
+                    dirty = true;
+                }
+            }
+        }
+        if (fireboyLives != fireLives) {
+            fireLives = fireboyLives;
+            setText(FireLives, "Fireboy x" + std::to_string(fireLives));
+        }
+        if (watergirlLives != waterLives) {
+            waterLives = watergirlLives;
+            setText(WaterLives, "Watergirl x" + std::to_string(waterLives));
+        }
+        const long t = static_cast<long>(elapsedSeconds * 10.f);
+        if (t != tenths) {
+            tenths = t;
+            std::ostringstream os;
+            os << "Time " << t / 600 << ":" << std::setw(2) << std::setfill('0') << (t / 10) % 60 << "." << t % 10;
+            setText(Time, os.str());
+        }
+    }
+
+    std::size_t labelRebuilds() const { return rebuilds; }
+
+    // drawn in screen space; returns the number of draw calls
+    std::size_t draw(sf::RenderTarget& target) {
+        if (!visible || !font) return 0;
+        const float width = static_cast<float>(target.getSize().x);
+        if (dirty || width != laidOutWidth) {
+            vertices.clear();
+            float y = MARGIN;
+            for (const Label& label : labels) {
+                for (sf::Vertex v : label.quads) {
+                    v.position += sf::Vector2f(width - MARGIN, y);
+                    vertices.append(v);
+                }
+                y += lineSpacing;
+            }
+            laidOutWidth = width;
+            dirty = false;
+        }
+        const sf::View world = target.getView();
+        target.setView(target.getDefaultView());
+        sf::RenderStates states;
+        states.texture = &font->getTexture(CHARACTER_SIZE);
+        target.draw(vertices, states);
+        target.setView(world);
+        return 1;
+    }
+};
+
+// -------------------------------
+// Character
+// -------------------------------
+// simulated state of a character as plain bytes (no visuals), for rewind snapshots;
+// value-initialize it so the padding is zero and unchanged fields delta-compress to nothing
+struct CharacterState {
+    float x, y, prevX, prevY, vx, vy;
+    std::int32_t lives;
+    std::uint8_t onGround;
+    std::int8_t walkDirection;
+    std::uint8_t pad[2]; // explicit, so there is no uninitialized padding
+};
+static_assert(std::is_trivially_copyable_v<CharacterState>);
+
+class Character {
+private:
+    std::string name;
+    Element element;
+    std::string spritePath; // image of the character in the sprite atlas (see Game::refreshAssets)
+    sf::Color fallbackColor; // drawn as a plain tile of this color while there is no image
+    sf::Vector2f position; // world coordinates (top-left)
+    sf::Vector2f previousPosition; // position at the start of the current fixed step (for interpolation)
+    sf::Vector2f velocity;
+    int lives;
+    bool onGround;
+    int walkDirection = 0; // -1 left, 1 right, 0 idle; set by input, consumed by update()
+
+public:
+    // movement constants (LevelSolver builds its jump templates from these)
+    static constexpr float SPEED = 160.f; // px/s
+    static constexpr float JUMP_IMPULSE = 360.f; // initial jump velocity
+    static constexpr float GRAVITY = 900.f;
+
+    // constructor parametric
+    // the character owns no texture: the renderer looks its sprite up in the atlas by `imagePath`
+    // (an empty path keeps the fallback color for good)
+    Character(const std::string& nm, Element el, const std::string& imagePath,
+          const sf::Vector2f& pos = {0.f,0.f}, int lifeCount = 3,
+          const sf::Color& fallback = sf::Color::White)
+    : name(nm), element(el), spritePath(imagePath), fallbackColor(fallback), position(pos), previousPosition(pos),
+      velocity(0.f, 0.f), lives(lifeCount), onGround(false)
+    {
+    }
+
+    // copy constructor (default is ok but implement explicitly to satisfy assignment)
+    Character (const Character& other)
+        : name(other.name),
+          element(other.element),
+          spritePath(other.spritePath),
+          fallbackColor(other.fallbackColor),
+          position(other.position),
+          previousPosition(other.previousPosition),
+          velocity(other.velocity),
+          lives(other.lives),
+          onGround(other.onGround),
+          walkDirection(other.walkDirection)
+    {
+    }
+
+    Character& operator=(const Character& other) {
+        if (this == &other) return *this;
+        name = other.name;
+        element = other.element;
+        spritePath = other.spritePath;
+        fallbackColor = other.fallbackColor;
+        position = other.position;
+        previousPosition = other.previousPosition;
+        velocity = other.velocity;
+        lives = other.lives;
+        onGround = other.onGround;
+        walkDirection = other.walkDirection;
+        return *this;
+    }
+
+    ~Character() = default;
+
+    // getters
+    const std::string& getName() const { return name; }
+    Element getElement() const { return element; }
+    int getLives() const { return lives; }
+    sf::Vector2f getPosition() const { return position; }
+
+    // expose bounds for collision checks
+    // the physics body is always one tile, whatever the sprite looks like, so the
+    // simulation does not depend on whether (or when) an image finished loading
+    sf::FloatRect bounds() const {
+        return {position, {Tile::getSize(), Tile::getSize()}};
+    }
+
+    // set position (useful for respawn)
+    void setPosition(const sf::Vector2f& p) { position = p; }
+
+    // remember where this fixed step starts so rendering can interpolate towards the new state
+    void beginStep() { previousPosition = position; }
+
+    // A public complex function: apply gravity, integrate velocity and resolve the motion against
+    // the tile grid with a swept AABB, x axis first, then y. Each sweep scans only the cells between
+    // the old and the new edge, so a long step cannot tunnel through a platform and the cost grows
+    // with the distance moved instead of with dt - no sub-stepping needed.
+    void update(float dt, const Map& map) {
+        velocity.x = static_cast<float>(walkDirection) * SPEED;
+        walkDirection = 0;
+        velocity.y += GRAVITY * dt;
+
+        const std::uint8_t self = elementBit(element);
+        const sf::FloatRect b = bounds();
+        const sf::Vector2f size(b.width, b.height);
+        bool blocked = false;
+        position.x += map.sweepX({position, size}, velocity.x * dt, self, blocked);
+        if (blocked) velocity.x = 0.f;
+
+        // grounded only while something solid stops the fall (re-checked every step,
+        // so walking off a ledge starts falling)
+        const bool falling = velocity.y > 0.f;
+        position.y += map.sweepY({position, size}, velocity.y * dt, self, blocked);
+        onGround = blocked && falling;
+        if (blocked) velocity.y = 0.f;
+    }
+
+    // apply a push-out correction from a dynamic body (see EntityWorld::collideBody),
+    // swept through the tiles so it can never push the character into a wall
+    void pushOut(const sf::Vector2f& delta, const Map& map) {
+        if (delta.x == 0.f && delta.y == 0.f) return;
+        const std::uint8_t self = elementBit(element);
+        const sf::FloatRect b = bounds();
+        const sf::Vector2f size(b.width, b.height);
+        bool blocked = false;
+        position.x += map.sweepX({position, size}, delta.x, self, blocked);
+        position.y += map.sweepY({position, size}, delta.y, self, blocked);
+        if (delta.x != 0.f) velocity.x = 0.f;
+        if (delta.y < 0.f && velocity.y > 0.f) { velocity.y = 0.f; onGround = true; }
+        if (delta.y > 0.f && velocity.y < 0.f) velocity.y = 0.f;
+    }
+
+    // walk left/right during the next update (pressing both cancels out)
+    void moveLeft() { --walkDirection; }
+    void moveRight() { ++walkDirection; }
+
+    // jump: complex (only if on ground)
+    void jump() {
+        if (onGround) {
+            velocity.y = -JUMP_IMPULSE;
+            onGround = false;
+        }
+    }
+
+    // apply damage & respawn
+    void takeDamageAndRespawn(const sf::Vector2f& respawnPos) {
+        if (lives > 0) --lives;
+        setPosition(respawnPos);
+        previousPosition = respawnPos; // teleport: do not interpolate across the respawn
+        velocity = {0.f, 0.f};
+        onGround = false;
+    }
+
+    // draw at the state interpolated between the previous and the current fixed step
+    // (alpha = 0 -> previous, alpha = 1 -> current)
+    sf::Vector2f interpolatedPosition(float alpha) const {
+        return previousPosition + (position - previousPosition) * alpha;
+    }
+
+    const std::string& getSpritePath() const { return spritePath; }
+    sf::Color getFallbackColor() const { return fallbackColor; }
+
+    friend std::ostream& operator<<(std::ostream& os, const Character& c) {
+        os << c.name << " pos=(" << (int)c.position.x << "," << (int)c.position.y << ") lives=" << c.lives;
+        return os;
+    }
+
+    // helper to set the fallback color (used at construction or later)
+    void setFallbackAppearance(const sf::Color& c) { fallbackColor = c; }
+
+    // fold the simulated state (not the visuals) into a hash
+    std::uint64_t stateHash(std::uint64_t h) const {
+        const float raw[4] = {position.x, position.y, velocity.x, velocity.y};
+        h = hashBytes(h, raw, sizeof(raw));
+        h = hashBytes(h, &lives, sizeof(lives));
+        return hashBytes(h, &onGround, sizeof(onGround));
+    }
+
+    CharacterState saveState() const {
+        CharacterState s{};
+        s.x = position.x; s.y = position.y;
+        s.prevX = previousPosition.x; s.prevY = previousPosition.y;
+        s.vx = velocity.x; s.vy = velocity.y;
+        s.lives = lives;
+        s.onGround = onGround ? 1 : 0;
+        s.walkDirection = static_cast<std::int8_t>(walkDirection);
+        return s;
+    }
+
+    void loadState(const CharacterState& s) {
+        position = {s.x, s.y};
+        previousPosition = {s.prevX, s.prevY};
+        velocity = {s.vx, s.vy};
+        lives = s.lives;
+        onGround = s.onGround != 0;
+        walkDirection = s.walkDirection;
+    }
+};
+
+// -------------------------------
+// LevelSolver (can both characters reach their exit without touching a hazard?)
+// -------------------------------
+// Reachability graph over standing cells (an open cell above a cell that is solid for the
+// element). Edges are walks to a neighbour cell and jumps. Each jump follows a template:
+// the list of cells the character box overlaps, traced once with the Character constants and
+// the fixed step. A template jumps, moves 0..MAX_JUMP_TILES columns (right away, or once the box
+// has risen a full row, to get onto a step next to it), then falls straight down until it lands.
+// Low ceilings get their own templates: the jump bumps its head one row up and carries on.
+// The check is conservative: a jump that bumps into a solid before it can land is dropped,
+// so an accepted level is solvable but a few solvable ones are rejected.
+class LevelSolver {
+private:
+    static constexpr int MAX_JUMP_TILES = 4;
+
+    struct JumpTemplate {
+        std::vector<Map::CellRange> cells; // overlapped cells (relative to the start cell), in order
+        int fallCol = 0, fallRow = 0; // box column and lowest row when the straight fall begins
+        bool bumpsCeiling = false; // only valid if one of the `ceiling` cells is solid
+        Map::CellRange ceiling{};
+    };
+
+    struct Node { int col, row, moves; };
+
+    // one element's view of the level as merged bitboards, built once per search
+    struct Masks {
+        TileMask solid, blocking, exits; // blocking = solid or hazardous
+        Masks(const Map& map, std::uint8_t self)
+            : solid(map.tileMask(SOLID_TYPES[self])),
+              blocking(map.tileMask(SOLID_TYPES[self] | HAZARD_TYPES[self])),
+              exits(map.tileMask(EXIT_TYPES[self])) {}
+    };
+
+    std::vector<JumpTemplate> jumps;
+
+    // trace one jump on an empty grid (or under a ceiling two rows up): `dir` * `tiles` columns of
+    // air control (starting once the box is `delayRows` rows up), then a straight fall
+    static JumpTemplate traceJump(int dir, int tiles, int delayRows, bool lowCeiling, float dt);
+
+    static const TileTraits& traitsAt(const Map& map, int col, int row) {
+        return tileTraits(map.getTileTypeAtGrid(col, row));
+    }
+
+    // fall straight down in `col` from a box whose lowest row is `row`; false if it hits a hazard.
+    // On success `row` is the standing row
+    static bool fall(const Map& map, std::uint8_t self, int col, int& row, bool& touchedExit) {
+        while (true) {
+            const TileTraits& below = traitsAt(map, col, row + 1);
+            if (below.solidFor & self) return true;
+            if (below.hazardFor & self) return false;
+            if (below.exitFor & self) touchedExit = true;
+            ++row;
+        }
+    }
+
+    // follow a jump template from the standing cell (col,row); false if it is blocked or deadly
+    static bool followJump(const Map& map, std::uint8_t self, const Masks& masks, const JumpTemplate& t,
+                           int col, int& row, int& landCol, bool& touchedExit) {
+        if (t.bumpsCeiling && !masks.solid.any(col + t.ceiling.col0, col + t.ceiling.col1,
+                                               row + t.ceiling.row0, row + t.ceiling.row1))
+            return false;
+        for (const Map::CellRange& r : t.cells) {
+            const int c0 = col + r.col0, c1 = col + r.col1, r0 = row + r.row0, r1 = row + r.row1;
+            if (masks.blocking.any(c0, c1, r0, r1)) return false;
+            if (masks.exits.any(c0, c1, r0, r1)) touchedExit = true;
+        }
+        landCol = col + t.fallCol;
+        row += t.fallRow;
+        return fall(map, self, landCol, row, touchedExit);
+    }
+
+public:
+    // the result of one element's search
+    struct Reach {
+        bool exitReachable = false;
+        int moves = -1; // fewest walks/jumps to the exit (-1 if unreachable)
+        int standingCells = 0; // standing cells reachable from the spawn
+    };
+
+    struct Result {
+        Reach fire, water;
+        bool solvable() const { return fire.exitReachable && water.exitReachable; }
+    };
+
+    explicit LevelSolver(float dt = 1.f / 120.f);
+
+    // breadth-first search over standing cells from the element's spawn
+    Reach reach(const Map& map, Element element) const;
+
+    Result solve(const Map& map) const {
+        return {reach(map, Element::Fire), reach(map, Element::Water)};
+    }
+
+    bool isSolvable(const Map& map) const {
+        return reach(map, Element::Fire).exitReachable && reach(map, Element::Water).exitReachable;
+    }
+
+    // shared solver for the fixed step of the game (templates are traced once)
+    static const LevelSolver& instance() {
+        static const LevelSolver solver;
+        return solver;
+    }
+};
+
+// -------------------------------
+// Input (key state of both characters for one simulation step)
+// -------------------------------
+enum class InputKey : std::uint8_t {
+    FireLeft = 1 << 0, FireRight = 1 << 1, FireJump = 1 << 2,
+    WaterLeft = 1 << 3, WaterRight = 1 << 4, WaterJump = 1 << 5
+};
+
+class InputFrame {
+private:
+    std::uint8_t bits = 0;
+
+public:
+    InputFrame() = default;
+    explicit InputFrame(std::uint8_t raw) : bits(raw) {}
+
+    void press(InputKey k) { bits |= static_cast<std::uint8_t>(k); }
+    bool isPressed(InputKey k) const { return (bits & static_cast<std::uint8_t>(k)) != 0; }
+    std::uint8_t raw() const { return bits; }
+
+    // networked play: each peer steers one character with either key set
+    InputFrame forElement(Element e) const {
+        const bool left = isPressed(InputKey::FireLeft) || isPressed(InputKey::WaterLeft);
+        const bool right = isPressed(InputKey::FireRight) || isPressed(InputKey::WaterRight);
+        const bool jump = isPressed(InputKey::FireJump) || isPressed(InputKey::WaterJump);
+        const bool fire = e == Element::Fire;
+        InputFrame out;
+        if (left) out.press(fire ? InputKey::FireLeft : InputKey::WaterLeft);
+        if (right) out.press(fire ? InputKey::FireRight : InputKey::WaterRight);
+        if (jump) out.press(fire ? InputKey::FireJump : InputKey::WaterJump);
+        return out;
+    }
+
+    // read the keyboard (windowed mode only; the simulation itself never polls devices)
+    static InputFrame pollKeyboard() {
+        InputFrame in;
+        // Fireboy controls: A D W
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) in.press(InputKey::FireLeft);
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) in.press(InputKey::FireRight);
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) in.press(InputKey::FireJump);
+        // Watergirl controls: F H T
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::F)) in.press(InputKey::WaterLeft);
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::H)) in.press(InputKey::WaterRight);
+        if (sf::Keyboard::isKeyPressed(sf::Keyboard::T)) in.press(InputKey::WaterJump);
+        return in;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const InputFrame& f) {
+        os << "Input[" << std::hex << static_cast<int>(f.bits) << std::dec << "]";
+        return os;
+    }
+};
+
+// deterministic pseudo-player: each character holds a direction for a random number
+// of steps and jumps now and then; the same seed always produces the same inputs
+class ScriptedInput {
+private:
+    std::mt19937 rng;
+    int fireDir = 0, waterDir = 0; // -1 left, 0 idle, 1 right
+    int fireHold = 0, waterHold = 0; // steps left before picking a new direction
+
+    void advance(int& dir, int& hold) {
+        if (hold > 0) { --hold; return; }
+        dir = std::uniform_int_distribution<int>(-1, 1)(rng);
+        hold = std::uniform_int_distribution<int>(20, 120)(rng);
+    }
+
+public:
+    explicit ScriptedInput(unsigned seed) : rng(seed) {}
+
+    InputFrame next() {
+        advance(fireDir, fireHold);
+        advance(waterDir, waterHold);
+        std::uniform_int_distribution<int> jumpDist(0, 59);
+        InputFrame in;
+        if (fireDir < 0) in.press(InputKey::FireLeft);
+        if (fireDir > 0) in.press(InputKey::FireRight);
+        if (jumpDist(rng) == 0) in.press(InputKey::FireJump);
+        if (waterDir < 0) in.press(InputKey::WaterLeft);
+        if (waterDir > 0) in.press(InputKey::WaterRight);
+        if (jumpDist(rng) == 0) in.press(InputKey::WaterJump);
+        return in;
+    }
+};
+
+// -------------------------------
+// InputLog (recorded session: level parameters + one input byte per simulation step)
+// -------------------------------
+// File layout (little endian):
+//   "FWIL" | u8 version | u16 mapW | u16 mapH | u32 levelSeed | u32 stepsPerSecond
+//   | u32 levelHashLo | u32 levelHashHi | u16 pathLength | path bytes    (version 2 only)
+//   | u32 stepCount
+//   followed by run-length encoded steps: u8 input bits, u8 run length (1..255).
+// An empty path (and every version 1 log) means the level generated from levelSeed.
+class InputLog {
+private:
+    static constexpr char MAGIC[4] = {'F', 'W', 'I', 'L'};
+    static constexpr std::uint8_t VERSION = 2; // 2 added the level file; version 1 logs are read as generated levels
+    static constexpr std::uint64_t MAX_MAP_TILES = std::uint64_t{1} << 24; // 4096x4096: replay allocates the map up front
+
+    int mapW, mapH;
+    unsigned levelSeed;
+    unsigned stepsPerSecond;
+    std::string levelPath; // empty: the level generated from levelSeed
+    std::uint64_t levelHash = 0; // levelHashOf the loaded level, so a changed file is noticed on replay
+    std::vector<std::uint8_t> steps; // decoded, one byte per step
+
+    static void putLE(std::ostream& os, std::uint32_t v, int bytes) {
+        for (int i = 0; i < bytes; ++i) os.put(static_cast<char>((v >> (8 * i)) & 0xFFu));
+    }
+    static bool getLE(std::istream& is, std::uint32_t& v, int bytes) {
+        v = 0;
+        for (int i = 0; i < bytes; ++i) {
+            const int ch = is.get();
+            if (ch == std::char_traits<char>::eof()) return false;
+            v |= static_cast<std::uint32_t>(ch) << (8 * i);
+        }
+        return true;
+    }
+
+public:
+    InputLog(int w = 14, int h = 9, unsigned seed = 12345, unsigned hz = 120)
+        : mapW(w), mapH(h), levelSeed(seed), stepsPerSecond(hz) {}
+
+    void append(const InputFrame& in) { steps.push_back(in.raw()); }
+    void truncate(std::size_t stepCount) { if (stepCount < steps.size()) steps.resize(stepCount); } // after a rewind
+    std::size_t size() const { return steps.size(); }
+    InputFrame operator[](std::size_t i) const { return InputFrame(steps[i]); }
+
+    int getMapWidth() const { return mapW; }
+    int getMapHeight() const { return mapH; }
+    unsigned getLevelSeed() const { return levelSeed; }
+    unsigned getStepsPerSecond() const { return stepsPerSecond; }
+
+    // the session was played on a level file (Map::loadFromFile), not on the generated level;
+    // `hash` is levelHashOf that level
+    void setLevelFile(const std::string& path, std::uint64_t hash) {
+        levelPath = path;
+        levelHash = hash;
+    }
+    const std::string& getLevelPath() const { return levelPath; }
+    std::uint64_t getLevelHash() const { return levelHash; }
+    static std::uint64_t levelHashOf(const Map& level) {
+        return hashBytes(14695981039346656037ull, level.tileData(),
+                         static_cast<std::size_t>(level.getWidth()) * static_cast<std::size_t>(level.getHeight()));
+    }
+
+    bool saveToFile(const std::string& path) const;
+
+    bool loadFromFile(const std::string& path);
+
+    friend std::ostream& operator<<(std::ostream& os, const InputLog& log) {
+        os << "InputLog map=" << log.mapW << "x" << log.mapH;
+        if (log.levelPath.empty()) os << " seed=" << log.levelSeed;
+        else os << " level=" << log.levelPath;
+        os << " rate=" << log.stepsPerSecond << "Hz steps=" << log.steps.size();
+        return os;
+    }
+};
+
+// -------------------------------
+// RewindBuffer (the last N steps of simulation state, delta-compressed, for rewind)
+// -------------------------------
+// Every step stores its state as the XOR with the previous step's state, encoded as
+// (u16 unchanged bytes, u16 changed bytes, changed bytes...) runs, plus the step's tile writes.
+// Every KEYFRAME_INTERVAL steps the state is stored whole (XOR with zeros), so a restore decodes
+// at most one keyframe and KEYFRAME_INTERVAL deltas; steps next to the current one are reached
+// by XOR-ing the deltas in between, forwards or backwards.
+// All memory is allocated up front: entries live in a circular byte arena, and the oldest steps
+// are dropped when it or the entry ring is full (always back to a keyframe).
+class RewindBuffer {
+private:
+    static constexpr std::uint64_t KEYFRAME_INTERVAL = 60;
+
+    struct Entry {
+        std::uint64_t tick = 0;
+        std::size_t offset = 0; // into `arena`: encoded state, then the tile changes
+        std::uint32_t stateLen = 0;
+        std::uint32_t tileCount = 0;
+        bool keyframe = false;
+    };
+
+    std::size_t stateSize;
+    std::vector<std::uint8_t> arena;
+    std::size_t writePos = 0;
+    std::vector<Entry> entries; // ring: `count` entries from `first`, consecutive ticks
+    std::size_t first = 0, count = 0;
+    std::uint64_t cursor = 0; // tick whose state is in `current`
+    bool captured = false;
+    std::vector<std::uint8_t> current;
+
+    // worst case: runs of one changed byte between two unchanged ones (4 bytes of header each)
+    static std::size_t maxEncodedSize(std::size_t n) { return 2 * n + 8; }
+
+    Entry& entryAt(std::uint64_t tick) { return entries[(first + (tick - entries[first].tick)) % entries.size()]; }
+    const Entry& entryAt(std::uint64_t tick) const {
+        return entries[(first + (tick - entries[first].tick)) % entries.size()];
+    }
+    static std::size_t bytesOf(const Entry& e) { return e.stateLen + e.tileCount * sizeof(Map::TileChange); }
+    Map::TileChange tileChange(const Entry& e, std::size_t i) const {
+        Map::TileChange c;
+        std::memcpy(&c, arena.data() + e.offset + e.stateLen + i * sizeof(c), sizeof(c));
+        return c;
+    }
+
+    void dropOldest() { first = (first + 1) % entries.size(); --count; }
+    void xorDelta(const Entry& e, std::uint8_t* state) const;
+    std::size_t encode(const std::uint8_t* state, const std::uint8_t* base, std::uint8_t* out) const;
+
+public:
+    // `stateBytes`: size of one state (Game::stateSize); `ticks`: steps to keep at most;
+    // `arenaBytes`: storage for the encoded steps (0 = room for `ticks` steps that change a
+    // quarter of the state, plus keyframes)
+    RewindBuffer(std::size_t stateBytes, std::size_t ticks, std::size_t arenaBytes = 0);
+
+    // append the state after the next step (the first capture is tick 0) with the tile writes that
+    // led to it. After a restore, the steps after the restored one are discarded first
+    void capture(const std::uint8_t* state, const std::vector<Map::TileChange>& tiles);
+
+    // decode the state of `tick` (oldestTick()..newestTick()) and move the map's tiles there;
+    // returns the state (valid until the next capture/restore), nullptr if the tick is not kept
+    const std::uint8_t* restore(std::uint64_t tick, Map& map);
+
+    bool empty() const { return count == 0; }
+    std::uint64_t oldestTick() const { return count ? entries[first].tick : 0; }
+    std::uint64_t newestTick() const { return count ? entries[(first + count - 1) % entries.size()].tick : 0; }
+    std::uint64_t currentTick() const { return cursor; }
+    std::size_t storedBytes() const;
+    std::size_t capacityBytes() const { return arena.size(); }
+
+    friend std::ostream& operator<<(std::ostream& os, const RewindBuffer& r) {
+        os << "RewindBuffer: ticks " << r.oldestTick() << ".." << r.newestTick() << " (" << r.count << " kept), "
+           << r.storedBytes() << "/" << r.arena.size() << " bytes, " << r.stateSize << " bytes per state";
+        return os;
+    }
+};
+
+// -------------------------------
+// FrameLimiter (frame pacing: sleep most of the frame, spin the rest, report the jitter)
+// -------------------------------
+// Deadlines advance by exactly one period, so the rate does not drift; a frame that is late by
+// more than a period starts a new schedule instead of rushing to catch up. The OS sleep wakes
+// up late by a varying amount, so the limiter sleeps until `spinMargin` before the deadline and
+// yields in a loop for the rest; the margin follows the observed oversleep.
+struct FramePacing {
+    bool vsync = false;
+    float fpsLimit = 60.f; // 0: no limit (or only vsync)
+    float idleFps = 10.f; // unfocused window, paused or won game
+};
+
+class FrameLimiter {
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::size_t HISTORY = 1024;
+
+    Clock::time_point deadline{}, lastFrame{};
+    Clock::duration spinMargin = std::chrono::microseconds(1000);
+    std::size_t frames = 0, throttledFrames = 0, pacedFrames = 0;
+    double sumMs = 0.0, sumSqMs = 0.0; // frame intervals
+    std::array<float, HISTORY> errorMs{}; // |interval - period| of the last paced frames
+    std::size_t errors = 0;
+
+public:
+    // block until one `period` after the previous deadline (no wait for a zero period);
+    // `throttled` frames only sleep (their timing does not matter), and are not counted as jitter
+    void wait(Clock::duration period, bool throttled) {
+        if (period > Clock::duration::zero()) {
+            const Clock::time_point now = Clock::now();
+            deadline = (deadline == Clock::time_point{} || now - deadline > period) ? now + period : deadline + period;
+            if (throttled) {
+                std::this_thread::sleep_until(deadline);
+            } else {
+                const Clock::time_point wake = deadline - spinMargin;
+                if (wake > now) {
+                    std::this_thread::sleep_until(wake);
+                    const Clock::duration overslept = Clock::now() - wake;
+                    spinMargin = std::clamp(std::max(spinMargin * 15 / 16, overslept * 3 / 2),
+                                            Clock::duration(std::chrono::microseconds(100)),
+                                            Clock::duration(std::chrono::milliseconds(4)));
+                }
+                while (Clock::now() < deadline) std::this_thread::yield();
+            }
+        } else {
+            deadline = {};
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (lastFrame != Clock::time_point{}) {
+            const double ms = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+            ++frames;
+            sumMs += ms;
+            sumSqMs += ms * ms;
+            if (throttled) {
+                ++throttledFrames;
+            } else if (period > Clock::duration::zero()) {
+                ++pacedFrames;
+                errorMs[errors++ % HISTORY] =
+                    static_cast<float>(std::abs(ms - std::chrono::duration<double, std::milli>(period).count()));
+            }
+        }
+        lastFrame = now;
+    }
+
+    // a pause in the frame sequence (e.g. a blocking call) should not count as a slow frame
+    void restart() { deadline = lastFrame = {}; }
+
+    friend std::ostream& operator<<(std::ostream& os, const FrameLimiter& l) {
+        const double mean = l.frames ? l.sumMs / static_cast<double>(l.frames) : 0.0;
+        const double var = l.frames ? std::max(0.0, l.sumSqMs / static_cast<double>(l.frames) - mean * mean) : 0.0;
+        os << l.frames << " intervals, mean " << mean << " ms (stddev " << std::sqrt(var) << " ms), "
+           << (l.frames ? 100.0 * static_cast<double>(l.throttledFrames) / static_cast<double>(l.frames) : 0.0) << "% throttled";
+        const std::size_t n = std::min(l.errors, HISTORY);
+        if (n > 0) {
+            std::vector<float> sorted(l.errorMs.begin(), l.errorMs.begin() + static_cast<std::ptrdiff_t>(n));
+            std::sort(sorted.begin(), sorted.end());
+            os << "; paced intervals off target by p50 " << sorted[n / 2] << " ms, p99 " << sorted[(n * 99) / 100]
+               << " ms, max " << sorted.back() << " ms";
+        }
+        return os;
+    }
+};
+
+// -------------------------------
+// TripleBuffer (one producer hands the latest value to one consumer, neither ever waits)
+// -------------------------------
+// The writer fills its own slot and swaps it with the shared middle slot; the reader swaps its
+// slot with the middle one only when a fresher value was published there. Values the reader
+// did not pick up in time are overwritten, so it always sees the newest complete one.
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr std::uint8_t INDEX = 3, FRESH = 4;
+
+    std::array<T, 3> slots{};
+    std::atomic<std::uint8_t> middle{1};
+    std::uint8_t back = 0; // the writer's slot
+    std::uint8_t front = 2; // the reader's slot
+
+public:
+    // writer side: fill writeBuffer(), then publish() it (the next writeBuffer() is another slot,
+    // holding some older value)
+    T& writeBuffer() { return slots[back]; }
+    void publish() { back = middle.exchange(static_cast<std::uint8_t>(back | FRESH), std::memory_order_acq_rel) & INDEX; }
+
+    // reader side: take the newest published value if there is one (returns false otherwise);
+    // readBuffer() stays valid until the next acquire
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& readBuffer() const { return slots[front]; }
+};
+
+// outcome of one simulated game (see Game::simulate)
+struct SimulationResult {
+    int steps = 0;
+    bool won = false;
+    bool fireboyAtExit = false;
+    bool watergirlAtExit = false;
+    int fireboyLives = 0;
+    int watergirlLives = 0;
+};
+
+class NetPeer; // online co-op, defined after Game
+
+// -------------------------------
+// Game (manages everything)
+// -------------------------------
+class Game {
+private:
+    // window is now optional: create only when not headless to avoid SFML allocations in CI
+    std::unique_ptr<sf::RenderWindow> window;
+    Map map;
+    Character fireboy;
+    Character watergirl;
+    EntityWorld entities; // boxes, moving platforms, walkers (empty on generated levels)
+    bool fireboyAtExit = false;
+    bool watergirlAtExit = false;
+    bool won = false;
+    std::uint32_t ticks = 0; // steps simulated; drives the sprite animations
+
+    // water flows and fire spreads every FLOW_INTERVAL steps (15 cells per second at 120 Hz);
+    // the automaton's own state is only a cache of the map, so rewind and rollback need nothing
+    static constexpr std::uint32_t FLOW_INTERVAL = 8;
+    TileAutomaton flow;
+    std::vector<Map::CellRange> flowBodies; // scratch: cells of the characters and entities
+    // no font/text as requested
+
+    bool headless = false; // true dacă nu putem deschide fereastra (CI Linux)
+
+    // fixed-timestep simulation: the simulation always advances in steps of `fixedStep`,
+    // rendering interpolates between the last two simulated states
+    float fixedStep = 1.f / 120.f;
+    static constexpr float MAX_FRAME_TIME = 0.25f; // spiral-of-death clamp: drop time beyond this per frame
+    float accumulator = 0.f;
+
+    InputLog* recorder = nullptr; // when set, every windowed step's input is appended here
+
+    // windowed frame pacing (see FramePacing); P pauses the simulation
+    FramePacing pacing;
+    FrameLimiter limiter;
+    bool paused = false;
+
+    // rewind (see enableRewind): every step's state is captured into `rewind`
+    struct SimState {
+        CharacterState fireboy, watergirl;
+        std::uint32_t ticks;
+        std::uint8_t fireboyAtExit, watergirlAtExit, won, pad; // explicit padding, always zero
+    };
+    static_assert(std::is_trivially_copyable_v<SimState>);
+    std::unique_ptr<RewindBuffer> rewind;
+    std::vector<std::uint8_t> rewindState; // scratch for captures, sized once
+
+    NetPeer* net = nullptr; // when set, the windowed loop advances through the peer (see NetPeer)
+
+    // windowed play on two threads (see runThreaded): the simulation thread publishes one
+    // snapshot per step, the render thread draws the newest one from its own copies of the scene
+    struct RenderSnapshot {
+        std::uint64_t steps = 0;
+        std::chrono::steady_clock::time_point time; // when the step finished
+        bool won = false;
+        std::vector<std::uint8_t> state; // saveState
+        std::vector<std::uint8_t> tiles; // only copied when the map's tileRevision changed
+        std::uint64_t tileRevision = ~std::uint64_t{0};
+    };
+    bool simulationThread = true;
+
+    // the window shows at most VIEW_COLS x VIEW_ROWS tiles; the camera follows the players
+    static constexpr int VIEW_COLS = 20;
+    static constexpr int VIEW_ROWS = 12;
+    sf::View camera;
+
+    // assets of the windowed game; they are decoded in the background (see prefetchAssets)
+    static constexpr const char* FIREBOY_TEXTURE = "assets/fireboy.jpeg";
+    static constexpr const char* WATERGIRL_TEXTURE = "assets/watergirl.jpg";
+    static constexpr const char* UI_FONT = "assets/arial.ttf";
+    static constexpr const char* TILE_ART_DIR = "assets/tiles/"; // optional <TileName>.png strips
+    static constexpr std::uint32_t TILE_STEPS_PER_FRAME = 15; // 8 animation frames per second at 120 Hz
+
+    // sprites: characters and the animated tiles in view go through one batch per atlas page;
+    // the atlas is rebuilt (at most a few times) as the images finish decoding
+    std::unique_ptr<TextureAtlas> atlas;
+    SpriteBatch sprites;
+    std::size_t atlasImages = 0; // decoded images packed into the current atlas
+    bool texturesPending = true;
+    std::array<const TextureAtlas::Animation*, static_cast<std::size_t>(TileType::Count)> tileSprites{};
+    std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+    bool firstFrameShown = false;
+
+    // frame profiler (see enableProfiling); the overlay exists only in windowed profiled runs
+    std::unique_ptr<ProfilerOverlay> overlay;
+    std::unique_ptr<Hud> hud; // windowed games only (F2 toggles it)
+
+    // flames and splashes over the hazard pools in view, and a burst where a character lost a life;
+    // visual only (never part of the simulated state), created for windowed and software frames
+    static constexpr std::size_t MAX_PARTICLES = 1u << 17;
+    static constexpr float POOL_PARTICLES_PER_SECOND = 40.f; // per pool surface tile
+    static constexpr float DEATH_BURST_PARTICLES = 400.f;
+    std::unique_ptr<ParticleSystem> particles;
+    unsigned particleThreads = 1;
+    std::array<int, 2> drawnLives{-1, -1}; // lives and positions of the last frame, to spot deaths
+    std::array<sf::Vector2f, 2> drawnPositions{};
+    std::string tracePath;
+
+    friend class GameProbe; // bench/: times private phases such as handleCollisions in isolation
+
+    // private helpers
+    void captureRewind() {
+        ProfileScope scope("RewindBuffer::capture");
+        saveState(rewindState.data());
+        rewind->capture(rewindState.data(), map.pendingTileChanges());
+        map.clearTileChanges();
+    }
+
+    void processInput(const InputFrame& in) {
+        ProfileScope scope("processInput");
+        if (won) return;
+
+        if (in.isPressed(InputKey::FireLeft)) fireboy.moveLeft();
+        if (in.isPressed(InputKey::FireRight)) fireboy.moveRight();
+        if (in.isPressed(InputKey::FireJump)) fireboy.jump();
+
+        if (in.isPressed(InputKey::WaterLeft)) watergirl.moveLeft();
+        if (in.isPressed(InputKey::WaterRight)) watergirl.moveRight();
+        if (in.isPressed(InputKey::WaterJump)) watergirl.jump();
+    }
+
+    // tile effects after movement (solids are already resolved by Character::update):
+    // bitboard queries for the tile types TILE_TRAITS marks for the character's element
+    void handleCollisions(Character& ch, const sf::Vector2f& respawnPos, bool& reachedExitForCharacter) {
+        const std::uint8_t self = elementBit(ch.getElement());
+        const Map::CellRange cells = Map::cellsOverlapping(ch.bounds());
+
+        const unsigned found = map.hazardAndExitFor(self, cells);
+
+        // Hazardous behavior (e.g. the opposite element's pool)
+        if (found & 1u) {
+            ch.takeDamageAndRespawn(respawnPos);
+            reachedExitForCharacter = false;
+            return;
+        }
+
+        // Exit tiles (non-solid)
+        if (found & 2u) reachedExitForCharacter = true;
+    }
+
+    void update(float dt) {
+        if (won) return;
+
+        // tiles first: the bodies then move and collide against this step's hazards
+        if (ticks % FLOW_INTERVAL == 0) {
+            flowBodies.assign({Map::cellsOverlapping(fireboy.bounds()), Map::cellsOverlapping(watergirl.bounds())});
+            entities.appendCells(flowBodies);
+            flow.step(map, ticks / FLOW_INTERVAL, flowBodies);
+        }
+        entities.step(dt, map);
+        {
+            ProfileScope scope("Character::update");
+            fireboy.update(dt, map);
+            watergirl.update(dt, map);
+            fireboy.pushOut(entities.collideBody(fireboy.bounds(), map), map);
+            watergirl.pushOut(entities.collideBody(watergirl.bounds(), map), map);
+        }
+        {
+            ProfileScope scope("handleCollisions");
+            handleCollisions(fireboy, map.respawnWorldPosForFire(), fireboyAtExit);
+            handleCollisions(watergirl, map.respawnWorldPosForWater(), watergirlAtExit);
+        }
+
+        if (fireboyAtExit && watergirlAtExit) {
+            // keep game state as won to stop further updates, but do not display/print anything
+            won = true;
+        }
+    }
+
+    SimulationResult resultAfter(int steps) const {
+        SimulationResult res;
+        res.steps = steps;
+        res.won = won;
+        res.fireboyAtExit = fireboyAtExit;
+        res.watergirlAtExit = watergirlAtExit;
+        res.fireboyLives = fireboy.getLives();
+        res.watergirlLives = watergirl.getLives();
+        return res;
+    }
+
+    // (re)build the sprite atlas once images finished decoding in the background; until then
+    // characters are drawn in their fallback color and tiles with generated art. `wait` decodes
+    // right away instead, so the first frame already has every image
+    void refreshAssets(const Character& fire, const Character& water, bool wait = false);
+
+    // tiles that get a sprite on top of their plain color: hazards and exits
+    static bool animatedTile(TileType t) {
+        return tileTraits(t).hazardFor != 0 || tileTraits(t).exitFor != 0;
+    }
+    static std::string tileArtPath(TileType t) { return TILE_ART_DIR + toString(t) + ".png"; }
+    // stand-in art for a tile type without a file: a strip of frames shaded from its color
+    static sf::Image generatedTileStrip(TileType t);
+
+    // particle looks: what a hazard tile gives off (nullptr: nothing) and a character's death burst
+    static const ParticleStyle* poolParticles(TileType t);
+    static const ParticleStyle& burstParticles(Element e);
+    void createParticles();
+    // emit for this frame (camera already placed) and advance the particles by `dt` seconds
+    void updateParticles(const Map& level, const Character& fire, const Character& water, float alpha, float dt);
+
+    double millisecondsSinceLaunch() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+    }
+
+    // center the camera between the two characters, clamped to the level
+    // (a level smaller than the view is centered)
+    void updateCamera(const Map& level, const Character& fire, const Character& water, float alpha) {
+        const float half = Tile::getSize() / 2.f;
+        const sf::Vector2f target = (fire.interpolatedPosition(alpha) + water.interpolatedPosition(alpha)) / 2.f
+                                    + sf::Vector2f(half, half);
+        const sf::FloatRect world = level.worldBounds();
+        const sf::Vector2f size = camera.getSize();
+        auto clampAxis = [](float center, float extent, float worldSize) {
+            if (worldSize <= extent) return worldSize / 2.f;
+            return std::clamp(center, extent / 2.f, worldSize - extent / 2.f);
+        };
+        camera.setCenter(clampAxis(target.x, size.x, world.width), clampAxis(target.y, size.y, world.height));
+    }
+
+    // the world (map, entities, sprites) through `camera` into `target`: the window or a SoftwareRenderer
+    template <typename Target>
+    std::size_t drawScene(Target& target, const Map& level, const EntityWorld& world, const Character& fire,
+                          const Character& water, float alpha, std::uint64_t tick);
+
+    // returns the number of draw calls of the frame; `frameSeconds` advances the particles
+    std::size_t render(float alpha, float frameSeconds) {
+        return render(map, entities, fireboy, watergirl, alpha, ticks, frameSeconds);
+    }
+    std::size_t render(const Map& level, const EntityWorld& world, const Character& fire, const Character& water,
+                       float alpha, std::uint64_t tick, float frameSeconds);
+
+    // the windowed loops: serial (input, steps and a frame in turn) or with the simulation on its own thread
+    void runSerial();
+    void runThreaded();
+    void publishSnapshot(TripleBuffer<RenderSnapshot>& snapshots, std::uint64_t steps) const;
+
+    // generated levels are re-rolled (with derived seeds) until the solver finds both exits reachable
+    static Map generatedLevel(int mapW, int mapH, unsigned levelSeed) {
+        Map level(mapW, mapH);
+        level.generateAscendingPlatforms(levelSeed, [](const Map& m) { return LevelSolver::instance().isSolvable(m); });
+        return level;
+    }
+
+public:
+    // play an existing level (generated or loaded with Map::loadFromFile); the characters
+    // start on the level's spawn cells. headless games never open a window (see detectHeadless)
+    explicit Game(Map level, bool headlessMode = false);
+
+    // levelSeed picks the generated level
+    Game(int mapW = 14, int mapH = 9, bool headlessMode = false, unsigned levelSeed = 12345)
+        : Game(generatedLevel(mapW, mapH, levelSeed), headlessMode) {}
+
+    float getSimulationRate() const { return 1.f / fixedStep; }
+
+    // one fixed simulation step: input and physics always see the same dt
+    void step(const InputFrame& in) {
+        ProfileScope scope("step");
+        fireboy.beginStep();
+        watergirl.beginStep();
+        processInput(in);
+        update(fixedStep);
+        ++ticks;
+        if (rewind) captureRewind();
+    }
+
+    // simulation state as plain bytes (stateSize() of them): characters, exit flags, entities;
+    // the tiles are restored separately from the map's change journal
+    std::size_t stateSize() const { return sizeof(SimState) + entities.stateBytes(); }
+
+    void saveState(std::uint8_t* out) const {
+        const SimState s{fireboy.saveState(), watergirl.saveState(), ticks,
+                         fireboyAtExit, watergirlAtExit, won, 0};
+        std::memcpy(out, &s, sizeof(s));
+        entities.saveState(out + sizeof(s));
+    }
+
+    void loadState(const std::uint8_t* in) {
+        SimState s;
+        std::memcpy(&s, in, sizeof(s));
+        fireboy.loadState(s.fireboy);
+        watergirl.loadState(s.watergirl);
+        ticks = s.ticks;
+        fireboyAtExit = s.fireboyAtExit != 0;
+        watergirlAtExit = s.watergirlAtExit != 0;
+        won = s.won != 0;
+        entities.loadState(in + sizeof(s));
+    }
+
+    // keep the last `seconds` of play for rewind: from now on every step is captured
+    // (the current state is tick 0) and tile writes are journaled
+    void enableRewind(float seconds) {
+        map.recordTileChanges(true);
+        rewindState.assign(stateSize(), 0);
+        rewind = std::make_unique<RewindBuffer>(rewindState.size(), static_cast<std::size_t>(seconds * getSimulationRate()) + 1);
+        captureRewind();
+    }
+
+    const RewindBuffer* rewindBuffer() const { return rewind.get(); }
+
+    // go back to a kept tick (the recorded input is cut there too); the next step continues from it
+    bool rewindTo(std::uint64_t tick) {
+        if (!rewind) return false;
+        const std::uint8_t* state = rewind->restore(tick, map);
+        if (!state) return false;
+        loadState(state);
+        if (recorder) recorder->truncate(static_cast<std::size_t>(tick));
+        return true;
+    }
+
+    // go back `steps` steps, or as far as the buffer reaches; returns the steps actually taken back
+    int rewindSteps(int steps) {
+        if (!rewind || rewind->empty()) return 0;
+        const std::uint64_t now = rewind->currentTick();
+        const std::uint64_t target = now - std::min<std::uint64_t>(static_cast<std::uint64_t>(steps), now - rewind->oldestTick());
+        return rewindTo(target) ? static_cast<int>(now - target) : 0;
+    }
+
+    // start decoding every image and font of the windowed game in parallel; call as early
+    // as possible so the work overlaps window creation
+    static void prefetchAssets() {
+        ImageCache::instance().prefetch(FIREBOY_TEXTURE);
+        ImageCache::instance().prefetch(WATERGIRL_TEXTURE);
+        for (std::size_t t = 0; t < TILE_TRAITS.size(); ++t)
+            if (animatedTile(static_cast<TileType>(t))) ImageCache::instance().prefetch(tileArtPath(static_cast<TileType>(t)));
+        FontCache::instance().prefetch(UI_FONT);
+    }
+
+    // simulation rate in steps per second (e.g. 120 Hz)
+    void setSimulationRate(float hz) {
+        assert(hz > 0.f);
+        fixedStep = 1.f / hz;
+    }
+
+    // run up to maxSteps fixed steps driven by a script (no window, no devices);
+    // stops early once both characters reached their exits
+    SimulationResult simulate(int maxSteps, ScriptedInput& script) {
+        int steps = 0;
+        while (steps < maxSteps && !won) {
+            step(script.next());
+            ++steps;
+        }
+        return resultAfter(steps);
+    }
+
+    // replay a recorded session step by step; with the same binary this reproduces
+    // the recorded end state exactly (compare stateHash())
+    SimulationResult replay(const InputLog& log) {
+        setSimulationRate(static_cast<float>(log.getStepsPerSecond()));
+        for (std::size_t i = 0; i < log.size(); ++i) step(log[i]);
+        return resultAfter(static_cast<int>(log.size()));
+    }
+
+    // record the input of every windowed step into `log` (nullptr stops recording)
+    void setRecorder(InputLog* log) { recorder = log; }
+
+    // play online: every windowed step goes through `peer` (local rewind is off meanwhile)
+    void setNetPeer(NetPeer* peer) { net = peer; }
+
+    void setFramePacing(const FramePacing& p) { pacing = p; }
+
+    // windowed play: simulate on a thread of its own (default) or in the render loop
+    void setSimulationThread(bool on) { simulationThread = on; }
+
+    // threads that step the awake blocks of the tile automaton (1: the simulation thread alone)
+    void setFlowThreads(unsigned threads) { flow.setWorkers(threads); }
+
+    // threads that update the particles (1: the render thread alone)
+    void setParticleThreads(unsigned threads) {
+        particleThreads = threads;
+        if (particles) particles->setWorkers(threads);
+    }
+
+    // the area of the level one frame shows (the window size), in pixels
+    sf::Vector2f getViewSize() const { return camera.getSize(); }
+
+    // draw the current state with the CPU rasterizer; works without a window (headless games
+    // included), sized like the window would be (see getViewSize); the particles advance by one
+    // fixed step per call, so a frame per step plays them at their real speed
+    void renderSoftware(SoftwareRenderer& target);
+
+    // record phase timings; the trace is written to `traceFile` when the game ends and on F9.
+    // Windowed games also show the overlay (F3 toggles it)
+    void enableProfiling(const std::string& traceFile) {
+        FrameProfiler::setEnabled(true);
+        tracePath = traceFile;
+        if (!headless) overlay = std::make_unique<ProfilerOverlay>(UI_FONT);
+    }
+
+    void exportTrace() const {
+        if (tracePath.empty()) return;
+        if (FrameProfiler::instance().exportChromeTrace(tracePath)) std::cout << "Wrote trace " << tracePath << "\n";
+        else std::cout << "Cannot write trace " << tracePath << "\n";
+    }
+
+    std::uint64_t stateHash() const {
+        std::uint64_t h = 14695981039346656037ull;
+        h = fireboy.stateHash(h);
+        h = watergirl.stateHash(h);
+        h = entities.stateHash(h);
+        // the tile automaton rewrites tiles, so they are simulated state too
+        h = hashBytes(h, map.tileData(), static_cast<std::size_t>(map.getWidth()) * static_cast<std::size_t>(map.getHeight()));
+        const bool flags[3] = {fireboyAtExit, watergirlAtExit, won};
+        return hashBytes(h, flags, sizeof(flags));
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Game& g) {
+        os << "Game state:\n";
+        os << "Map: " << g.map.getWidth() << "x" << g.map.getHeight() << "\n";
+        os << "Fireboy: " << g.fireboy << "\n";
+        os << "Watergirl: " << g.watergirl << "\n";
+        // intentionally do not print "Won" status to avoid any win message
+        return os;
+    }
+    // launch = when the process started, for the time-to-first-frame report
+    void run(std::chrono::steady_clock::time_point launch = std::chrono::steady_clock::now());
+
+};
+
+
+
+// -------------------------------
+// LinkConditioner (artificial latency, jitter and loss on outgoing packets, for testing on localhost)
+// -------------------------------
+struct LinkConditions {
+    float latencyMs = 0.f; // one way
+    float jitterMs = 0.f; // each packet is delayed by latency +- up to jitter (so packets can reorder)
+    float lossPercent = 0.f;
+
+    bool any() const { return latencyMs > 0.f || jitterMs > 0.f || lossPercent > 0.f; }
+};
+
+class LinkConditioner {
+private:
+    struct Pending {
+        std::chrono::steady_clock::time_point due;
+        sf::Packet packet;
+        sf::IpAddress address;
+        unsigned short port;
+    };
+
+    LinkConditions conditions;
+    std::mt19937 rng;
+    std::vector<Pending> queue;
+    std::size_t dropped = 0;
+
+public:
+    explicit LinkConditioner(const LinkConditions& c = {}, unsigned seed = 1) : conditions(c), rng(seed) {}
+
+    // send now, later (flush) or never, as the conditions say
+    void send(sf::UdpSocket& socket, sf::Packet& packet, const sf::IpAddress& address, unsigned short port) {
+        if (conditions.lossPercent > 0.f && std::uniform_real_distribution<float>(0.f, 100.f)(rng) < conditions.lossPercent) {
+            ++dropped;
+            return;
+        }
+        if (!conditions.any()) {
+            socket.send(packet, address, port);
+            return;
+        }
+        const float jitter = conditions.jitterMs > 0.f
+                           ? std::uniform_real_distribution<float>(-conditions.jitterMs, conditions.jitterMs)(rng) : 0.f;
+        const auto delay = std::chrono::duration<float, std::milli>(std::max(0.f, conditions.latencyMs + jitter));
+        queue.push_back({std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay),
+                         packet, address, port});
+    }
+
+    // send the delayed packets that are due
+    void flush(sf::UdpSocket& socket) {
+        const auto now = std::chrono::steady_clock::now();
+        auto due = std::partition(queue.begin(), queue.end(), [now](const Pending& p) { return p.due > now; });
+        for (auto it = due; it != queue.end(); ++it) socket.send(it->packet, it->address, it->port);
+        queue.erase(due, queue.end());
+    }
+
+    std::size_t droppedPackets() const { return dropped; }
+};
+
+// -------------------------------
+// NetPeer (online co-op over UDP: input delay + rollback)
+// -------------------------------
+// Each peer steers one character (the host Fireboy, the joining peer Watergirl) and simulates
+// both. A local input is scheduled `inputDelay` steps ahead and sent to the other peer with
+// every packet until it is acknowledged, so a lost packet only delays it. The remote input of
+// a step that has not arrived yet is predicted (the last known one repeats). When the real
+// input differs from the prediction, the game is restored to that step from its rewind history
+// and re-simulated up to the current step (at most `maxRollback` steps: beyond that the peer
+// waits). A peer that runs ahead of the other by a frame or more skips a step now and then, so
+// both stay within a frame of each other. Every HASH_INTERVAL steps the state hash of a
+// confirmed step is exchanged to detect desyncs.
+struct NetOptions {
+    unsigned short localPort = 0; // 0: any free port
+    std::string remoteHost; // empty: host a game and wait for the other peer
+    unsigned short remotePort = 0;
+    int inputDelay = 2; // steps
+    int maxRollback = 8; // predicted steps at most
+    LinkConditions link;
+};
+
+class NetPeer {
+private:
+    static constexpr sf::Uint32 MAGIC = 0x46575242; // "FWRB"
+    static constexpr std::uint32_t HISTORY = 256; // input ring (steps); far more than is ever in flight
+    static constexpr std::uint32_t HASH_INTERVAL = 60;
+    static constexpr std::uint32_t NONE = 0xFFFFFFFFu;
+    static constexpr std::uint32_t MAX_INPUTS_PER_PACKET = 128;
+    static constexpr float TIMEOUT_MS = 5000.f;
+
+    struct Checkpoint { std::uint32_t tick = NONE; std::uint64_t hash = 0; };
+
+    Game& game;
+    NetOptions options;
+    Element localElement;
+    sf::UdpSocket socket;
+    bool open = false;
+    sf::IpAddress remoteAddress;
+    unsigned short remotePort = 0;
+    bool connected = false;
+    LinkConditioner link;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    float stepMs;
+
+    // inputs by step (ring of HISTORY); steps below inputDelay are empty on both peers
+    std::array<std::uint8_t, HISTORY> localInputs{}, remoteInputs{}, usedRemote{};
+    std::uint32_t frame = 0; // steps simulated (= the game's tick)
+    std::uint32_t localKnown, remoteKnown; // local/remote inputs are known for the steps below these
+    std::uint32_t ackedByRemote; // the remote has our inputs for the steps below this
+    std::uint32_t rollbackFrom = NONE; // first simulated step whose predicted remote input was wrong
+
+    // time sync
+    std::uint32_t remoteFrame = 0;
+    float remoteAdvantage = 0.f, localAdvantage = 0.f; // frames ahead of the other peer (smoothed)
+    float rttMs = 0.f;
+    std::uint32_t remoteSentMs = 0;
+    float lastReceiveMs = 0.f;
+    int stepsSinceYield = 0;
+
+    // desync detection
+    std::array<Checkpoint, 8> checkpoints{};
+    Checkpoint remoteCheckpoint;
+    std::uint32_t lastCheckedTick = NONE;
+
+    struct Stats {
+        std::size_t steps = 0, rollbacks = 0, resimulated = 0, maxRollback = 0;
+        std::size_t waits = 0, yields = 0, sent = 0, received = 0;
+        std::size_t checks = 0, desyncs = 0;
+        float maxAdvantage = 0.f;
+    } stats;
+
+    float nowMs() const {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // inputs of `step`: the remote part is the real one if known, else the prediction
+    InputFrame inputsFor(std::uint32_t step) {
+        std::uint8_t remote = 0;
+        if (step < remoteKnown) remote = remoteInputs[step % HISTORY];
+        else if (remoteKnown > 0) remote = remoteInputs[(remoteKnown - 1) % HISTORY];
+        usedRemote[step % HISTORY] = remote;
+        return InputFrame(static_cast<std::uint8_t>(localInputs[step % HISTORY] | remote));
+    }
+
+    void simulate(std::uint32_t step);
+    void rollback();
+    bool shouldYield();
+    void receive();
+    void sendInputs();
+
+public:
+    // binds the socket (see isOpen); the game keeps a rewind history from now on (rollbacks
+    // restore from it)
+    NetPeer(Game& g, const NetOptions& opts);
+
+    NetPeer(const NetPeer&) = delete;
+    NetPeer& operator=(const NetPeer&) = delete;
+
+    // one fixed step: receive, roll back if a prediction was wrong, then simulate the next step
+    // with `local` (the keys of this player, see InputFrame::forElement), unless the peer has to
+    // wait for the other one. Returns true if a step was simulated
+    bool advance(const InputFrame& local);
+
+    bool isOpen() const { return open; } // false if the local port could not be bound
+    bool isConnected() const { return connected; }
+    bool remoteLost() const { return connected && nowMs() - lastReceiveMs > TIMEOUT_MS; }
+    bool isHost() const { return localElement == Element::Fire; }
+    unsigned short localPort() const { return socket.getLocalPort(); }
+    std::uint32_t currentStep() const { return frame; }
+    // steps below this were simulated with both real inputs (final on both peers)
+    std::uint32_t confirmedStep() const { return std::min(frame, remoteKnown); }
+    // both inputs of a confirmed step that is still in the input history
+    InputFrame confirmedInputs(std::uint32_t step) const {
+        assert(step < confirmedStep() && step + HISTORY > frame);
+        return InputFrame(static_cast<std::uint8_t>(localInputs[step % HISTORY] | remoteInputs[step % HISTORY]));
+    }
+    std::size_t desyncs() const { return stats.desyncs; }
+
+    // state hash after `tick` steps (confirmed and still in the rewind history); the game is
+    // put back on the current step afterwards
+    std::uint64_t confirmedHash(std::uint32_t tick) {
+        assert(tick <= confirmedStep());
+        if (!game.rewindTo(tick)) return 0;
+        const std::uint64_t h = game.stateHash();
+        game.rewindTo(frame);
+        return h;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const NetPeer& p);
+};
+
+// -------------------------------
+// WorkStealingPool (fixed worker threads, one task deque per worker)
+// -------------------------------
+// Workers pop from the back of their own deque and steal from the front of
+// the others, so uneven task lengths still keep every core busy.
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::jthread> workers;
+    std::atomic<std::size_t> pending{0}; // submitted and not yet finished
+    std::atomic<std::size_t> queued{0}; // submitted and not yet picked up by a worker
+    std::atomic<std::size_t> nextQueue{0};
+    std::mutex sleepMtx;
+    std::condition_variable wakeWorkers;
+    std::condition_variable allDone;
+    bool stopping = false;
+
+    bool tryPop(std::size_t self, std::function<void()>& task) {
+        {
+            Queue& own = *queues[self];
+            std::lock_guard lock(own.mtx);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard lock(victim.mtx);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(std::size_t self) {
+        std::function<void()> task;
+        while (true) {
+            if (tryPop(self, task)) {
+                task();
+                task = nullptr;
+                if (pending.fetch_sub(1) == 1) {
+                    std::lock_guard lock(sleepMtx);
+                    allDone.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock lock(sleepMtx);
+            wakeWorkers.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threadCount; ++i) workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard lock(sleepMtx);
+            stopping = true;
+        }
+        wakeWorkers.notify_all();
+        // jthread joins on destruction
+    }
+
+    std::size_t threadCount() const { return workers.size(); }
+
+    void submit(std::function<void()> task) {
+        pending.fetch_add(1);
+        Queue& q = *queues[nextQueue.fetch_add(1) % queues.size()];
+        {
+            std::lock_guard lock(q.mtx);
+            q.tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        std::lock_guard lock(sleepMtx);
+        wakeWorkers.notify_one();
+    }
+
+    // block until every submitted task has finished
+    void wait() {
+        std::unique_lock lock(sleepMtx);
+        allDone.wait(lock, [this] { return pending.load() == 0; });
+    }
+};
+
+// -------------------------------
+// Batch simulation (many independent headless games, used to validate generated levels)
+// -------------------------------
+struct BatchOptions {
+    int games = 1000;
+    int maxSteps = 120 * 60; // one simulated minute at the default 120 Hz
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency()); // 0 when unknown
+    unsigned baseSeed = 1;
+    int mapW = 14, mapH = 9;
+};
+
+class BatchRunner {
+private:
+    struct GameRecord {
+        SimulationResult result;
+        double seconds = 0.0;
+    };
+
+    BatchOptions options;
+    std::vector<GameRecord> records;
+    double wallSeconds = 0.0;
+
+    static double percentile(std::vector<double> sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        std::size_t idx = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    }
+
+public:
+    explicit BatchRunner(const BatchOptions& opts) : options(opts) {}
+
+    void run() {
+        records.assign(static_cast<std::size_t>(options.games), GameRecord{});
+        const auto start = std::chrono::steady_clock::now();
+        {
+            WorkStealingPool pool(options.threads);
+            for (int i = 0; i < options.games; ++i) {
+                pool.submit([this, i] {
+                    const unsigned seed = options.baseSeed + static_cast<unsigned>(i);
+                    const auto t0 = std::chrono::steady_clock::now();
+                    Game game(options.mapW, options.mapH, true, seed);
+                    ScriptedInput script(seed * 2654435761u);
+                    GameRecord& rec = records[static_cast<std::size_t>(i)];
+                    rec.result = game.simulate(options.maxSteps, script);
+                    rec.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                });
+            }
+            pool.wait();
+        }
+        wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const BatchRunner& b) {
+        long long steps = 0;
+        int wins = 0, fireExits = 0, waterExits = 0;
+        std::vector<double> times;
+        times.reserve(b.records.size());
+        for (const GameRecord& rec : b.records) {
+            steps += rec.result.steps;
+            wins += rec.result.won;
+            fireExits += rec.result.fireboyAtExit;
+            waterExits += rec.result.watergirlAtExit;
+            times.push_back(rec.seconds * 1000.0);
+        }
+        std::sort(times.begin(), times.end());
+        const double games = b.records.empty() ? 1.0 : static_cast<double>(b.records.size());
+        double mean = 0.0;
+        for (double t : times) mean += t;
+        mean /= games;
+
+        os << std::fixed << std::setprecision(2);
+        os << "Batch: " << b.records.size() << " games, seeds " << b.options.baseSeed << ".."
+           << b.options.baseSeed + b.records.size() - 1 << ", " << b.options.threads << " threads\n";
+        os << "  wall time: " << b.wallSeconds << " s, steps: " << steps
+           << ", steps/s: " << (b.wallSeconds > 0.0 ? steps / b.wallSeconds : 0.0) << "\n";
+        os << "  win rate: " << 100.0 * wins / games << "% (Fireboy at exit " << 100.0 * fireExits / games
+           << "%, Watergirl at exit " << 100.0 * waterExits / games << "%)\n";
+        os << "  per-game ms: min " << (times.empty() ? 0.0 : times.front()) << ", mean " << mean
+           << ", p50 " << percentile(times, 0.50) << ", p95 " << percentile(times, 0.95)
+           << ", max " << (times.empty() ? 0.0 : times.back()) << "\n";
+        os << std::defaultfloat;
+        return os;
+    }
+};
+
+// -------------------------------
+// SeedScorer (runs LevelSolver over a range of level seeds, in parallel)
+// -------------------------------
+// Seeds are handed out in blocks so a task amortizes its setup; every block reuses one Map.
+class SeedScorer {
+private:
+    static constexpr int SEEDS_PER_TASK = 4096;
+
+    struct Tally {
+        long long solvable = 0, fireReachable = 0, waterReachable = 0;
+        long long moves = 0; // summed over solvable seeds (both characters)
+        int hardestMoves = -1;
+        unsigned hardestSeed = 0;
+    };
+
+    BatchOptions options;
+    std::vector<Tally> tallies; // one per task, merged when printing
+    double wallSeconds = 0.0;
+
+    void scoreBlock(std::size_t task) {
+        const long long first = static_cast<long long>(task) * SEEDS_PER_TASK;
+        const long long last = std::min<long long>(first + SEEDS_PER_TASK, options.games);
+        const LevelSolver& solver = LevelSolver::instance();
+        Map level(options.mapW, options.mapH);
+        Tally tally;
+        for (long long i = first; i < last; ++i) {
+            const unsigned seed = options.baseSeed + static_cast<unsigned>(i);
+            level.generateAscendingPlatforms(seed);
+            const LevelSolver::Result r = solver.solve(level);
+            tally.fireReachable += r.fire.exitReachable;
+            tally.waterReachable += r.water.exitReachable;
+            if (!r.solvable()) continue;
+            ++tally.solvable;
+            const int moves = r.fire.moves + r.water.moves;
+            tally.moves += moves;
+            if (moves > tally.hardestMoves) { tally.hardestMoves = moves; tally.hardestSeed = seed; }
+        }
+        tallies[task] = tally;
+    }
+
+public:
+    explicit SeedScorer(const BatchOptions& opts) : options(opts) {}
+
+    void run() {
+        const std::size_t tasks = (static_cast<std::size_t>(options.games) + SEEDS_PER_TASK - 1) / SEEDS_PER_TASK;
+        tallies.assign(tasks, Tally{});
+        const auto start = std::chrono::steady_clock::now();
+        {
+            WorkStealingPool pool(options.threads);
+            for (std::size_t t = 0; t < tasks; ++t) pool.submit([this, t] { scoreBlock(t); });
+            pool.wait();
+        }
+        wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const SeedScorer& s) {
+        Tally total;
+        for (const Tally& t : s.tallies) {
+            total.solvable += t.solvable;
+            total.fireReachable += t.fireReachable;
+            total.waterReachable += t.waterReachable;
+            total.moves += t.moves;
+            if (t.hardestMoves > total.hardestMoves) { total.hardestMoves = t.hardestMoves; total.hardestSeed = t.hardestSeed; }
+        }
+        const double seeds = s.options.games > 0 ? static_cast<double>(s.options.games) : 1.0;
+        os << std::fixed << std::setprecision(2);
+        os << "Seeds: " << s.options.games << " levels " << s.options.mapW << "x" << s.options.mapH << ", seeds "
+           << s.options.baseSeed << ".." << s.options.baseSeed + static_cast<unsigned>(s.options.games) - 1
+           << ", " << s.options.threads << " threads\n";
+        os << "  wall time: " << s.wallSeconds << " s, seeds/s: " << (s.wallSeconds > 0.0 ? seeds / s.wallSeconds : 0.0)
+           << ", us/seed/thread: " << s.wallSeconds * 1e6 * std::max(1u, s.options.threads) / seeds << "\n";
+        os << "  solvable: " << 100.0 * total.solvable / seeds << "% (Fireboy exit reachable "
+           << 100.0 * total.fireReachable / seeds << "%, Watergirl exit reachable " << 100.0 * total.waterReachable / seeds << "%)\n";
+        if (total.solvable > 0)
+            os << "  moves to both exits: mean " << static_cast<double>(total.moves) / total.solvable
+               << ", hardest seed " << total.hardestSeed << " (" << total.hardestMoves << " moves)\n";
+        os << std::defaultfloat;
+        return os;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "TileType.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// -------------------------------
+// Binary level format (.fwl)
+// -------------------------------
+// A 32-byte LevelHeader followed by width*height tile bytes (row-major TileType values).
+// All fields are little endian and the header is read in place from the mapped file,
+// so a level is loaded without parsing or per-tile construction.
+//
+// Text levels (input of the level_converter tool) use one character per tile:
+//   .  empty      #  solid      f  fire pool    w  water pool
+//   F  fire exit  W  water exit  =  wood (burns)   1  Fireboy spawn  2  Watergirl spawn (both empty tiles)
+// Lines starting with ';' are comments; all rows must have the same length.
+static_assert(std::endian::native == std::endian::little, "binary levels are read in place as little endian");
+
+struct LevelHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t headerSize;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint16_t fireSpawnCol, fireSpawnRow;
+    std::uint16_t waterSpawnCol, waterSpawnRow;
+    std::uint16_t fireExitCol, fireExitRow;
+    std::uint16_t waterExitCol, waterExitRow;
+
+    static constexpr char MAGIC[4] = {'F', 'W', 'L', 'V'};
+    static constexpr std::uint16_t VERSION = 1;
+
+    // header checks plus the file being big enough for all tiles
+    bool isValid(std::size_t fileSize) const {
+        return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && version == VERSION &&
+               headerSize == sizeof(LevelHeader) && width > 0 && height > 0 &&
+               fileSize >= sizeof(LevelHeader) + static_cast<std::size_t>(width) * height;
+    }
+};
+static_assert(sizeof(LevelHeader) == 32, "LevelHeader is an on-disk layout");
+
+// text level character <-> tile code (spawn markers are empty tiles)
+constexpr bool tileFromLevelChar(char ch, TileType& out) {
+    switch (ch) {
+        case '.': case '1': case '2': out = TileType::Empty; return true;
+        case '#': out = TileType::Solid; return true;
+        case 'f': out = TileType::Fire; return true;
+        case 'w': out = TileType::Water; return true;
+        case 'F': out = TileType::ExitFire; return true;
+        case 'W': out = TileType::ExitWater; return true;
+        case '=': out = TileType::Wood; return true;
+        default: return false;
+    }
+}
+
+// true when every byte is a valid TileType code. Checks 8 tiles per step: adding (0x80 - Count)
+// to a byte sets its high bit exactly when the byte is >= Count (bytes >= 0x80 are caught directly)
+inline bool tileCodesValid(const std::uint8_t* tiles, std::size_t count) {
+    constexpr std::uint64_t ONES = 0x0101010101010101ull;
+    constexpr std::uint64_t HIGH_BITS = 0x80 * ONES;
+    constexpr std::uint64_t BIAS = (0x80 - static_cast<std::uint64_t>(TileType::Count)) * ONES;
+    std::uint64_t seen = 0;
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, tiles + i, sizeof(word));
+        seen |= word | (word + BIAS);
+    }
+    for (; i < count; ++i)
+        if (tiles[i] >= static_cast<std::uint8_t>(TileType::Count)) return false;
+    return (seen & HIGH_BITS) == 0;
+}
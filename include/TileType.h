@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// one byte per tile so a whole map is a single contiguous buffer;
+// the values are also the on-disk tile codes of binary levels (see LevelFormat.h)
+enum class TileType : std::uint8_t { Empty, Solid, Fire, Water, ExitFire, ExitWater, Wood, Count };
@@ -1,667 +1,398 @@
-#if defined(__clang__)
-    #pragma clang diagnostic push
-    #pragma clang diagnostic ignored "-Wdeprecated-declarations"
-#elif defined(_MSC_VER)
-    #pragma warning(push)
-    #pragma warning(disable : 4996) // MSVC: disable warnings for deprecated funcs
-#endif
-#include <SFML/Graphics.hpp>
-#include <iostream>
-#include <vector>
-#include <string>
-#include <random>
-#include <sstream>
-#include <cassert>
-#include <algorithm>
-#include <memory>
-
-#if defined(__clang__)
-    #pragma clang diagnostic pop
-#elif defined(_MSC_VER)
-    #pragma warning(pop)
-#endif
+#include "Engine.h"
 
 using std::string;
 using std::vector;
 using std::cout;
 using std::endl;
 
-
-enum class TileType { Empty, Solid, Fire, Water, ExitFire, ExitWater };
-
-static string toString(TileType t) {
-    switch (t) {
-        case TileType::Empty: return "Empty";
-        case TileType::Solid: return "Solid";
-        case TileType::Fire: return "Fire";
-        case TileType::Water: return "Water";
-        case TileType::ExitFire: return "ExitFire";
-        case TileType::ExitWater: return "ExitWater";
-    }
-    return "Unknown";
-}
-
-class Tile {
-private:
-    TileType type;
-    sf::RectangleShape rect; // visual representation (fallback)
-    int gx, gy; // grid coordinates (col,row)
-    static constexpr float TILE_SIZE = 48.f;
-
-    void initShape() {
-        rect.setSize({TILE_SIZE, TILE_SIZE});
-        rect.setPosition(gx * TILE_SIZE, gy * TILE_SIZE);
-        switch (type) {
-            case TileType::Empty: rect.setFillColor(sf::Color(80,80,80)); break;
-            case TileType::Solid: rect.setFillColor(sf::Color(120,120,120)); break;
-            case TileType::Fire: rect.setFillColor(sf::Color::Red); break;
-            case TileType::Water: rect.setFillColor(sf::Color::Blue); break;
-            case TileType::ExitFire: rect.setFillColor(sf::Color(255,140,0)); break;
-            case TileType::ExitWater: rect.setFillColor(sf::Color(0,200,100)); break;
+// online play without a window: scripted input for this peer's character, until `steps` steps
+// are confirmed by both peers; prints the state hash there (the other process prints the same)
+static int runHeadlessPeer(NetPeer& peer, float stepsPerSecond, int steps) {
+    ScriptedInput script(peer.isHost() ? 1u : 2u);
+    InputFrame next = script.next();
+    const auto stepTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / stepsPerSecond));
+    const auto start = std::chrono::steady_clock::now();
+    auto wake = start;
+    const auto target = static_cast<std::uint32_t>(steps);
+    std::uint64_t hash = 0;
+    bool hashed = false;
+    // after our confirmation, keep answering for a moment so the other peer can confirm too
+    int linger = static_cast<int>(stepsPerSecond / 2.f);
+    while (linger > 0) {
+        if (peer.advance(next)) next = script.next();
+        if (!hashed && peer.confirmedStep() >= target) {
+            hash = peer.confirmedHash(target);
+            hashed = true;
         }
-    }
-
-public:
-    // constructor parametric
-    explicit Tile(TileType t , int col , int row )
-        : type(t), gx(col), gy(row) {
-        initShape();
-    }
-
-    // copy / assign default are fine
-    Tile(const Tile& other) = default;
-    Tile& operator=(const Tile& other) = default;
-    ~Tile() = default;
-
-    TileType getType() const { return type; }
-    int getCol() const { return gx; }
-    int getRow() const { return gy; }
-    static float getSize() { return TILE_SIZE; }
-
-    // draw (const)
-    void draw(sf::RenderTarget& target) const {
-        if (type != TileType::Empty) target.draw(rect);
-        else {
-            // draw a faint empty tile if you want
-            // target.draw(rect);
+        if (hashed) --linger;
+        if (peer.remoteLost()) {
+            std::cout << "Lost the other peer\n";
+            break;
         }
-    }
-
-    // get bounding box in world coords
-    sf::FloatRect bounds() const {
-        return rect.getGlobalBounds();
-    }
-
-    friend std::ostream& operator<<(std::ostream& os, const Tile& t) {
-        os << "[" << toString(t.type) << " @" << t.gx << "," << t.gy << "]";
-        return os;
-    }
-};
-
-// -------------------------------
-// Character
-// -------------------------------
-class Character {
-private:
-    string name;
-    sf::Texture texture;
-    sf::Sprite sprite;
-    sf::RectangleShape fallbackShape;
-    bool usingTexture;
-    sf::Vector2f position; // world coordinates (top-left)
-    sf::Vector2f velocity;
-    int lives;
-    bool onGround;
-
-    float speed = 160.f; // px/s
-    float jumpImpulse = 360.f; // initial jump velocity
-    static constexpr float GRAVITY = 900.f;
-
-    void initFallbackShape(const sf::Color& c, const sf::Vector2f& size) {
-        fallbackShape.setSize(size);
-        fallbackShape.setFillColor(c);
-        fallbackShape.setPosition(position);
-    }
-
-public:
-
-    // constructor parametric
-    Character(const string& nm, const string& texturePath,
-          const sf::Vector2f& pos = {0.f,0.f}, int lifeCount = 3,
-          const sf::Color& fallbackColor = sf::Color::White)
-    : name(nm), usingTexture(false), position(pos), velocity(0.f, 0.f),
-      lives(lifeCount), onGround(false)
-    {
-        // try load texture (if not found, use fallback rectangle)
-        if (!texturePath.empty() && texture.loadFromFile(texturePath)) {
-            usingTexture = true;
-            sprite.setTexture(texture);
-            // scale sprite to tile size if texture height > 0
-            if (texture.getSize().y > 0) {
-                float factor = Tile::getSize() / texture.getSize().y;
-                sprite.setScale(factor, factor);
-            }
-            sprite.setPosition(position);
-        } else {
-            usingTexture = false;
-            initFallbackShape(fallbackColor, {Tile::getSize(), Tile::getSize()});
+        if (!peer.isConnected() && std::chrono::steady_clock::now() - start > std::chrono::seconds(30)) {
+            std::cout << "Nobody joined\n";
+            break;
         }
+        wake += stepTime;
+        std::this_thread::sleep_until(wake);
     }
+    cout << peer << endl;
+    if (!hashed) return 1;
+    cout << "State hash after " << target << " steps: " << std::hex << hash << std::dec << endl;
+    return 0;
+}
 
-    //get on ground state - now also clears vertical velocity when set true
-    void setOnGround(bool state) {
-         onGround = state;
-         if (onGround) {
-             velocity.y = 0.f; // stop vertical movement when we consider the character grounded
-         }
-    }
-    // copy constructor (default is ok but implement explicitly to satisfy assignment)
-    Character (const Character& other)
-        : name(other.name),
-          texture(other.texture),
-          sprite(other.sprite),
-          fallbackShape(other.fallbackShape),
-          usingTexture(other.usingTexture),
-          position(other.position),
-          velocity(other.velocity),
-          lives(other.lives),
-          onGround(other.onGround),
-          speed(other.speed),
-          jumpImpulse(other.jumpImpulse)
-    {
-        if (usingTexture) sprite.setTexture(texture);
-    }
-
-    Character& operator=(const Character& other) {
-        if (this == &other) return *this;
-        name = other.name;
-        texture = other.texture;
-        sprite = other.sprite;
-        fallbackShape = other.fallbackShape;
-        usingTexture = other.usingTexture;
-        position = other.position;
-        velocity = other.velocity;
-        lives = other.lives;
-        onGround = other.onGround;
-        speed = other.speed;
-        jumpImpulse = other.jumpImpulse;
-        if (usingTexture) sprite.setTexture(texture);
-        return *this;
-    }
-
-    ~Character() = default;
-
-    // getters
-    const string& getName() const { return name; }
-    int getLives() const { return lives; }
-    sf::Vector2f getPosition() const { return position; }
-
-    // expose bounds for collision checks
-    sf::FloatRect bounds() const {
-        if (usingTexture) return sprite.getGlobalBounds();
-        return fallbackShape.getGlobalBounds();
-    }
-
-    // set position (useful for respawn)
-    void setPosition(const sf::Vector2f& p) {
-        position = p;
-        if (usingTexture) sprite.setPosition(position);
-        else fallbackShape.setPosition(position);
-    }
-
-    // A public complex function: update physics, apply gravity, integrate velocity
-    // We split large dt into smaller sub-steps to avoid tunneling
-    bool update(float dt, const sf::FloatRect& worldBounds) {
-        // Sub-stepping: limit step to avoid tunneling when dt is large
-        const float maxStep = 0.02f; // 20ms per sub-step (~50Hz)
-        while (dt > 0.f) {
-            float step = std::min(dt, maxStep);
-            // apply gravity only if not on ground
-            if (!onGround) velocity.y += GRAVITY * step;
-            // integrate
-            position += velocity * step;
-
-            // simple floor collision with world bounds bottom
-            if (position.y + Tile::getSize() > worldBounds.top + worldBounds.height) {
-                position.y = worldBounds.top + worldBounds.height - Tile::getSize();
-                velocity.y = 0.f;
-                onGround = true;
-            } else {
-                // allow collisions to set onGround appropriately later
-                onGround = false;
-            }
-
-            // prevent leaving world horizontally
-            if (position.x < worldBounds.left) position.x = worldBounds.left;
-            if (position.x + Tile::getSize() > worldBounds.left + worldBounds.width)
-                position.x = worldBounds.left + worldBounds.width - Tile::getSize();
-
-            dt -= step;
-        }
-
-        // update visual
-        if (usingTexture) sprite.setPosition(position);
-        else fallbackShape.setPosition(position);
-
-        return true;
-    }
-
-    // move left/right - uses dt multiplier outside or inside; we provide velocity-based per-call
-    void moveLeft(float dt) { position.x -= speed * dt; if (usingTexture) sprite.setPosition(position); else fallbackShape.setPosition(position); }
-    void moveRight(float dt) { position.x += speed * dt; if (usingTexture) sprite.setPosition(position); else fallbackShape.setPosition(position); }
-
-    // jump: complex (only if on ground)
-    void jump() {
-        if (onGround) {
-            velocity.y = -jumpImpulse;
-            onGround = false;
+// both peers in this process, talking over UDP on localhost through the link injector; the
+// result is compared with a plain simulation of the confirmed inputs
+static int runNetTest(const NetOptions& options, int steps) {
+    Map level(14, 9);
+    level.generateAscendingPlatforms(12345, [](const Map& m) { return LevelSolver::instance().isSolvable(m); });
+    Game hostGame(level, true), joinGame(level, true);
+
+    NetOptions hostOptions = options;
+    hostOptions.localPort = 0;
+    hostOptions.remoteHost.clear();
+    NetPeer host(hostGame, hostOptions);
+    NetOptions joinOptions = options;
+    joinOptions.localPort = 0;
+    joinOptions.remoteHost = "127.0.0.1";
+    joinOptions.remotePort = host.localPort();
+    NetPeer join(joinGame, joinOptions);
+    if (!host.isOpen() || !join.isOpen()) {
+        std::cout << "Cannot open UDP sockets on localhost\n";
+        return 1;
+    }
+    std::cout << "Net test: " << steps << " steps, latency " << options.link.latencyMs << " ms +- "
+              << options.link.jitterMs << " ms, loss " << options.link.lossPercent << "%, input delay "
+              << options.inputDelay << ", max rollback " << options.maxRollback << "\n";
+
+    ScriptedInput hostScript(1), joinScript(2);
+    InputFrame hostNext = hostScript.next(), joinNext = joinScript.next();
+    vector<InputFrame> confirmed; // both inputs of every confirmed step, as the host saw them
+    const auto target = static_cast<std::uint32_t>(steps);
+    const auto stepTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / hostGame.getSimulationRate()));
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + stepTime * (4 * steps) + std::chrono::seconds(10);
+    auto wake = start;
+    while (host.confirmedStep() < target || join.confirmedStep() < target) {
+        if (host.advance(hostNext)) hostNext = hostScript.next();
+        if (join.advance(joinNext)) joinNext = joinScript.next();
+        while (confirmed.size() < std::min(host.confirmedStep(), target))
+            confirmed.push_back(host.confirmedInputs(static_cast<std::uint32_t>(confirmed.size())));
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cout << "Net test timed out\n" << host << "\n" << join << "\n";
+            return 1;
         }
-    }
-
-    // apply damage & respawn
-    void takeDamageAndRespawn(const sf::Vector2f& respawnPos) {
-        if (lives > 0) --lives;
-        setPosition(respawnPos);
-        velocity = {0.f, 0.f};
-        onGround = false;
-    }
-
-    // draw
-    void draw(sf::RenderTarget& target) const {
-        if (usingTexture) target.draw(sprite);
-        else target.draw(fallbackShape);
-    }
-
-    friend std::ostream& operator<<(std::ostream& os, const Character& c) {
-        os << c.name << " pos=(" << (int)c.position.x << "," << (int)c.position.y << ") lives=" << c.lives;
-        return os;
-    }
-
-    // helper to set fallback color size (used at construction or later)
-    void setFallbackAppearance(const sf::Color& c) {
-        fallbackShape.setFillColor(c);
-        fallbackShape.setSize({Tile::getSize(), Tile::getSize()});
-        fallbackShape.setPosition(position);
-    }
+        wake += stepTime;
+        std::this_thread::sleep_until(wake);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Game reference(level, true);
+    for (const InputFrame& in : confirmed) reference.step(in);
+    const std::uint64_t hostHash = host.confirmedHash(target), joinHash = join.confirmedHash(target);
+    const bool inSync = hostHash == joinHash && hostHash == reference.stateHash() && host.desyncs() + join.desyncs() == 0;
+    cout << host << "\n" << join << "\n";
+    cout << "Finished in " << seconds << " s; state hash after " << target << " steps: host " << std::hex << hostHash
+         << ", peer " << joinHash << ", local simulation " << reference.stateHash() << std::dec
+         << (inSync ? " (in sync)" : " (DESYNC)") << endl;
+    return inSync ? 0 : 1;
+}
 
-    // expose a small helper to zero vertical velocity (used by collision resolver)
-    void stopVerticalMovement() { velocity.y = 0.f; }
+// headless rendering through the CPU rasterizer: a scripted game is drawn after every step
+// (that is what the FPS covers); every `every`-th frame is written to `captureDir` and/or
+// compared with the file of the same name in `goldenDir`
+struct CaptureOptions {
+    int steps = 600;
+    int every = 60;
+    string captureDir, goldenDir;
+    string format = "ppm"; // or any format sf::Image writes, e.g. png
+    unsigned tolerance = 0; // per channel, for the golden comparison
 };
 
-// -------------------------------
-// Map (contains Tiles) - implement copy ctor/operator=/destructor explicitly
-// -------------------------------
-class Map {
-private:
-    vector<vector<Tile>> grid;
-    int width, height;
-
-    // helper to create grid
-    void allocateGrid(int w, int h, TileType defaultType = TileType::Empty) {
-        width = w; height = h;
-        grid.assign(height, vector<Tile>(width, Tile(defaultType, 0, 0)));
-        for (int r = 0; r < height; ++r)
-            for (int c = 0; c < width; ++c)
-                grid[r][c] = Tile(defaultType, c, r);
-    }
-
-public:
-    // constructor parametric
-    Map(int w = 12, int h = 8, TileType defaultType = TileType::Empty) {
-        allocateGrid(w,h,defaultType);
-    }
-
-    // copy constructor (explicit)
-    Map(const Map& other) {
-        width = other.width;
-        height = other.height;
-        grid.reserve(height);
-        for (int r = 0; r < height; ++r) {
-            vector<Tile> row;
-            row.reserve(width);
-            for (int c = 0; c < width; ++c) row.push_back(other.grid[r][c]);
-            grid.push_back(std::move(row));
-        }
-    }
-
-    // copy assignment
-    Map& operator=(const Map& other) {
-        if (this == &other) return *this;
-        width = other.width;
-        height = other.height;
-        grid.clear();
-        grid.reserve(height);
-        for (int r = 0; r < height; ++r) {
-            vector<Tile> row;
-            row.reserve(width);
-            for (int c = 0; c < width; ++c) row.push_back(other.grid[r][c]);
-            grid.push_back(std::move(row));
-        }
-        return *this;
-    }
-
-    // destructor
-    ~Map() {
-        // No raw pointers, but destructor explicitly present to satisfy requirement.
-    }
-
-    int getWidth() const { return width; }
-    int getHeight() const { return height; }
-
-    // complex public function: generate ascending platforms randomly
-    // "ascending" -> platforms generally going upward from left to right
-    void generateAscendingPlatforms(unsigned seed = 0) {
-        // clear first
-        for (int r=0;r<height;++r)
-            for (int c=0;c<width;++c)
-                grid[r][c] = Tile(TileType::Empty, c, r);
-
-        std::mt19937 rng((seed==0)? std::random_device{}() : seed);
-        std::uniform_int_distribution<int> gapDist(1,3);
-        std::uniform_int_distribution<int> lengthDist(1,3);
-
-        int currentRow = height - 2; // start near bottom
-        int c = 1;
-        while (c < width-1 && currentRow > 0) {
-            int len = lengthDist(rng);
-            for (int k = 0; k < len && c < width-1; ++k) {
-                grid[currentRow][c] = Tile(TileType::Solid, c, currentRow);
-                ++c;
+static int runRenderTest(Map level, const CaptureOptions& options, unsigned seed) {
+    Game game(std::move(level), true);
+    const sf::Vector2f view = game.getViewSize();
+    SoftwareRenderer target(static_cast<unsigned>(view.x), static_cast<unsigned>(view.y));
+    ScriptedInput script(seed);
+
+    vector<double> frameMs;
+    frameMs.reserve(static_cast<std::size_t>(options.steps));
+    int captured = 0, compared = 0, mismatched = 0;
+    for (int step = 1; step <= options.steps; ++step) {
+        game.step(script.next());
+        const auto t0 = std::chrono::steady_clock::now();
+        game.renderSoftware(target);
+        frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        if (options.every <= 0 || step % options.every != 0) continue;
+
+        std::ostringstream name;
+        name << "frame_" << std::setw(5) << std::setfill('0') << step << "." << options.format;
+        if (!options.captureDir.empty()) {
+            const string path = options.captureDir + "/" + name.str();
+            if (!target.saveToFile(path)) {
+                std::cout << "Cannot write " << path << "\n";
+                return 1;
             }
-            int gap = gapDist(rng);
-            c += gap;
-            // ascend sometimes
-            if (currentRow > 1) currentRow -= 1;
+            ++captured;
         }
-
-        // create some special tiles: fire patch and water patch in different places
-        // ensure they are on top of solids or on their own row
-        grid[height-2][2] = Tile(TileType::Fire, 2, height-2);
-        grid[height-3][width-3] = Tile(TileType::Water, width-3, height-3);
-
-        // exits: place exit for Fireboy (ExitFire) and for Watergirl (ExitWater)
-        // place Fire exit on top-right, Water exit on top-left (if available)
-        grid[1][width-2] = Tile(TileType::ExitFire, width-2, 1);
-        grid[1][1] = Tile(TileType::ExitWater, 1, 1);
-    }
-
-    // get tile type at world coords (x,y in pixels) OR by grid coords
-    TileType getTileTypeAtGrid(int col, int row) const {
-        if (col < 0 || col >= width || row < 0 || row >= height) return TileType::Solid;
-        return grid[row][col].getType();
-    }
-
-    // get tile type by world position
-    TileType getTileTypeAtWorld(float x, float y) const {
-        int col = static_cast<int>(x / Tile::getSize());
-        int row = static_cast<int>(y / Tile::getSize());
-        return getTileTypeAtGrid(col, row);
-    }
-
-    // draw map
-    void draw(sf::RenderTarget& target) const {
-        for (int r = 0; r < height; ++r)
-            for (int c = 0; c < width; ++c)
-                grid[r][c].draw(target);
-    }
-
-    friend std::ostream& operator<<(std::ostream& os, const Map& m) {
-        os << "Map " << m.width << "x" << m.height << "\n";
-        for (int r = 0; r < m.height; ++r) {
-            for (int c = 0; c < m.width; ++c) {
-                os << m.grid[r][c];
+        if (!options.goldenDir.empty()) {
+            const string path = options.goldenDir + "/" + name.str();
+            sf::Image golden;
+            ++compared;
+            if (!SoftwareRenderer::loadImage(path, golden)) {
+                std::cout << "  " << name.str() << ": no golden image\n";
+                ++mismatched;
+                continue;
+            }
+            const SoftwareRenderer::Difference diff = target.compare(golden, options.tolerance);
+            if (!diff.sameSize || diff.pixels > 0) {
+                ++mismatched;
+                std::cout << "  " << name.str() << ": ";
+                if (!diff.sameSize) std::cout << "size differs\n";
+                else std::cout << diff.pixels << " pixels differ (max channel delta " << diff.maxDelta << ")\n";
             }
-            os << "\n";
         }
-        return os;
     }
 
-    // get world bounds as rectangle
-    sf::FloatRect worldBounds() const {
-        return sf::FloatRect(0.f, 0.f, width * Tile::getSize(), height * Tile::getSize());
-    }
+    const std::size_t frames = frameMs.size();
+    double total = 0.0;
+    for (double ms : frameMs) total += ms;
+    std::sort(frameMs.begin(), frameMs.end());
+    std::cout << std::fixed << std::setprecision(3) << "Software renderer: " << frames << " frames of "
+              << target.getSize().x << "x" << target.getSize().y << " in " << total << " ms, "
+              << (total > 0.0 ? 1000.0 * static_cast<double>(frames) / total : 0.0) << " fps (mean "
+              << (frames ? total / static_cast<double>(frames) : 0.0) << " ms, p99 "
+              << (frames ? frameMs[(frames * 99) / 100] : 0.0) << " ms), "
+              << (frames ? target.quadsDrawn() / frames : 0) << " quads per frame\n" << std::defaultfloat;
+    if (captured > 0) std::cout << "Captured " << captured << " frames to " << options.captureDir << "\n";
+    if (compared > 0) std::cout << "Golden check: " << compared - mismatched << " of " << compared << " frames match\n";
+    return mismatched == 0 ? 0 : 1;
+}
 
-    // find respawn positions for characters (grid col,row) -> world pos
-    sf::Vector2f respawnWorldPosForFire() const {
-        // left-bottom corner safe spot
-        return sf::Vector2f(Tile::getSize() * 1.f, Tile::getSize() * (height - 2));
+// detect headless - verificăm DOAR dacă suntem în CI SAU nu avem DISPLAY pe Linux
+static bool detectHeadless() {
+    const char* ciEnv = std::getenv("CI");
+    if (ciEnv != nullptr && std::string(ciEnv) == "true") {
+        std::cout << "Detected CI environment, running in headless mode.\n";
+        return true;
     }
-    sf::Vector2f respawnWorldPosForWater() const {
-        return sf::Vector2f(Tile::getSize() * 5.f, Tile::getSize() * (height - 2));
+#ifndef _WIN32
+    // Pe Linux/macOS verificăm DISPLAY doar dacă nu suntem deja în headless
+    const char* displayEnv = std::getenv("DISPLAY");
+    if (displayEnv == nullptr || std::string(displayEnv).empty()) {
+        std::cout << "No DISPLAY environment variable, running in headless mode.\n";
+        return true;
     }
-};
-
-// -------------------------------
-// Utility collision helpers
-// -------------------------------
-static bool intersects(const sf::FloatRect& a, const sf::FloatRect& b) {
-    return a.intersects(b);
+#endif
+    return false;
 }
 
-// -------------------------------
-// Game (manages everything)
-// -------------------------------
-class Game {
-private:
-    // window is now optional: create only when not headless to avoid SFML allocations in CI
-    std::unique_ptr<sf::RenderWindow> window;
-    Map map;
-    Character fireboy;
-    Character watergirl;
-    bool fireboyAtExit = false;
-    bool watergirlAtExit = false;
-    bool won = false;
-    // no font/text as requested
-
-    bool headless = false; // true dacă nu putem deschide fereastra (CI Linux)
-
-    // private helpers
-    void processInput(float dt) {
-        if (headless || won) return;
-
-        // Fireboy controls: A D W
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::A)) fireboy.moveLeft(dt);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::D)) fireboy.moveRight(dt);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::W)) fireboy.jump();
-
-        // Watergirl controls: F H T
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::F)) watergirl.moveLeft(dt);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::H)) watergirl.moveRight(dt);
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::T)) watergirl.jump();
-    }
-
-    // collision handling with tiles
-    void handleCollisions(Character& ch, const sf::Vector2f& respawnPos, bool& reachedExitForCharacter, TileType whatExit) {
-        (void) whatExit;
-        sf::FloatRect cb = ch.bounds();
-        int leftCol = std::max(0, static_cast<int>(cb.left / Tile::getSize()));
-        int rightCol = std::min(map.getWidth()-1, static_cast<int>((cb.left + cb.width) / Tile::getSize()));
-        int topRow = std::max(0, static_cast<int>(cb.top / Tile::getSize()));
-        int bottomRow = std::min(map.getHeight()-1, static_cast<int>((cb.top + cb.height) / Tile::getSize()));
-
-        for (int r = topRow; r <= bottomRow; ++r) {
-            for (int c = leftCol; c <= rightCol; ++c) {
-                TileType tt = map.getTileTypeAtGrid(c, r);
-
-                // Determine if this tile should act as a solid for THIS character:
-                // - Solid tiles are always solid
-                // - Fire tiles are solid for Fireboy
-                // - Water tiles are solid for Watergirl
-                bool isSolidForThis = false;
-                if (tt == TileType::Solid) isSolidForThis = true;
-                else if (tt == TileType::Fire && ch.getName() == "Fireboy") isSolidForThis = true;
-                else if (tt == TileType::Water && ch.getName() == "Watergirl") isSolidForThis = true;
-
-                if (isSolidForThis) {
-                    sf::FloatRect tileRect(c * Tile::getSize(), r * Tile::getSize(), Tile::getSize(), Tile::getSize());
-                    if (intersects(cb, tileRect)) {
-                        float charCenterY = cb.top + cb.height*0.5f;
-                        float tileCenterY = tileRect.top + tileRect.height*0.5f;
-                        // Mark grounded and zero vertical velocity
-                        ch.setOnGround(true);
-                        if (charCenterY < tileCenterY) {
-                            // landed on top
-                            ch.setPosition({cb.left, tileRect.top - cb.height});
-                        } else {
-                            // collided from below
-                            ch.setPosition({cb.left, tileRect.top + tileRect.height});
-                            // hitting head should also stop upward velocity
-                            ch.stopVerticalMovement();
-                        }
-                        // after resolving a solid collision, update cb for subsequent checks
-                        cb = ch.bounds();
-                    }
-                }
+// a game or thread count: at least one (below that, std::out_of_range like a malformed number)
+static int positiveCount(const string& text) {
+    const int n = std::stoi(text);
+    if (n < 1) throw std::out_of_range("count below one");
+    return n;
+}
 
-                // Hazardous behavior for opposite element:
-                if (tt == TileType::Fire && ch.getName() == "Watergirl") {
-                    ch.takeDamageAndRespawn(respawnPos);
-                    reachedExitForCharacter = false;
-                    return;
-                } else if (tt == TileType::Water && ch.getName() == "Fireboy") {
-                    ch.takeDamageAndRespawn(respawnPos);
-                    reachedExitForCharacter = false;
-                    return;
-                }
+static void printUsage() {
+    std::cout << "usage: oop [--batch GAMES [--steps N] [--threads N] [--seed S]]\n"
+                 "           [--record FILE]   record the input of a windowed offline session\n"
+                 "           [--replay FILE]   replay a recorded session headless (on the same level file, if one was used)\n"
+                 "           [--level FILE]    play a binary level (see tools/level_converter)\n"
+                 "           [--profile FILE]  profile frame phases, write a Chrome trace (F3 overlay, F9 export)\n"
+                 "           [--rewind SECONDS] rewind history kept while playing (hold Backspace; 0 = off, default 10)\n"
+                 "           [--vsync] [--fps N] [--idle-fps N] frame pacing (default 60 fps, 0 = unlimited; 10 fps when\n"
+                 "                             the window is unfocused or the game is paused (P) or won)\n"
+                 "           [--single-thread] simulate in the render loop instead of on a thread of its own\n"
+                 "           [--particle-threads N] threads that update the flame and splash particles (default 1)\n"
+                 "           [--flow-threads N] threads that step flowing water and spreading fire (default 1)\n"
+                 "           [--host PORT | --join HOST:PORT] online co-op (host: Fireboy, joining peer: Watergirl;\n"
+                 "                             headless peers play scripted input for --steps steps)\n"
+                 "           [--net-test STEPS] two peers over UDP on localhost, checked against a local simulation\n"
+                 "             online options: [--input-delay N] [--max-rollback N]\n"
+                 "                             [--net-latency MS] [--net-jitter MS] [--net-loss PERCENT]\n"
+                 "           [--render-test STEPS] draw a scripted game with the CPU rasterizer (no display needed)\n"
+                 "             [--capture DIR] [--capture-every N] [--capture-format ppm|png] write every N-th frame\n"
+                 "             [--golden DIR] [--golden-tolerance N] compare them with earlier captures instead\n"
+                 "           [--score-seeds COUNT [--threads N] [--seed S]] solvability of generated levels\n";
+}
 
-                // Exit tiles (non-solid) - check after solid/hazard handling
-                if (tt == TileType::ExitFire && ch.getName() == "Fireboy") {
-                    sf::FloatRect tileRect(c * Tile::getSize(), r * Tile::getSize(), Tile::getSize(), Tile::getSize());
-                    if (intersects(cb, tileRect)) reachedExitForCharacter = true;
-                } else if (tt == TileType::ExitWater && ch.getName() == "Watergirl") {
-                    sf::FloatRect tileRect(c * Tile::getSize(), r * Tile::getSize(), Tile::getSize(), Tile::getSize());
-                    if (intersects(cb, tileRect)) reachedExitForCharacter = true;
-                }
+int main(int argc, char* argv[]) {
+    const auto launch = std::chrono::steady_clock::now();
+    const vector<string> args(argv + 1, argv + argc);
+    bool batchMode = false, scoreMode = false;
+    BatchOptions batch;
+    string recordPath, replayPath, levelPath, profilePath;
+    float rewindSeconds = 10.f;
+    NetOptions net;
+    FramePacing pacing;
+    bool simulationThread = true;
+    unsigned particleThreads = 1;
+    unsigned flowThreads = 1;
+    bool netPlay = false, netTest = false;
+    bool renderTest = false;
+    CaptureOptions capture;
+    try {
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const bool hasValue = i + 1 < args.size();
+            if (args[i] == "--batch" && hasValue) { batchMode = true; batch.games = positiveCount(args[++i]); }
+            else if (args[i] == "--score-seeds" && hasValue) { scoreMode = true; batch.games = positiveCount(args[++i]); }
+            else if (args[i] == "--steps" && hasValue) batch.maxSteps = std::stoi(args[++i]);
+            else if (args[i] == "--threads" && hasValue) batch.threads = static_cast<unsigned>(positiveCount(args[++i]));
+            else if (args[i] == "--seed" && hasValue) batch.baseSeed = static_cast<unsigned>(std::stoul(args[++i]));
+            else if (args[i] == "--record" && hasValue) recordPath = args[++i];
+            else if (args[i] == "--replay" && hasValue) replayPath = args[++i];
+            else if (args[i] == "--level" && hasValue) levelPath = args[++i];
+            else if (args[i] == "--profile" && hasValue) profilePath = args[++i];
+            else if (args[i] == "--rewind" && hasValue) rewindSeconds = std::stof(args[++i]);
+            else if (args[i] == "--vsync") pacing.vsync = true;
+            else if (args[i] == "--single-thread") simulationThread = false;
+            else if (args[i] == "--fps" && hasValue) pacing.fpsLimit = std::stof(args[++i]);
+            else if (args[i] == "--idle-fps" && hasValue) pacing.idleFps = std::stof(args[++i]);
+            else if (args[i] == "--particle-threads" && hasValue) particleThreads = static_cast<unsigned>(std::stoul(args[++i]));
+            else if (args[i] == "--flow-threads" && hasValue) flowThreads = static_cast<unsigned>(std::stoul(args[++i]));
+            else if (args[i] == "--host" && hasValue) {
+                netPlay = true;
+                net.localPort = static_cast<unsigned short>(std::stoul(args[++i]));
+            }
+            else if (args[i] == "--join" && hasValue) {
+                const string& target = args[++i];
+                const std::size_t colon = target.rfind(':');
+                if (colon == string::npos) { printUsage(); return 1; }
+                netPlay = true;
+                net.remoteHost = target.substr(0, colon);
+                net.remotePort = static_cast<unsigned short>(std::stoul(target.substr(colon + 1)));
             }
+            else if (args[i] == "--net-test" && hasValue) { netTest = true; batch.maxSteps = std::stoi(args[++i]); }
+            else if (args[i] == "--input-delay" && hasValue) net.inputDelay = std::stoi(args[++i]);
+            else if (args[i] == "--max-rollback" && hasValue) net.maxRollback = std::stoi(args[++i]);
+            else if (args[i] == "--net-latency" && hasValue) net.link.latencyMs = std::stof(args[++i]);
+            else if (args[i] == "--net-jitter" && hasValue) net.link.jitterMs = std::stof(args[++i]);
+            else if (args[i] == "--net-loss" && hasValue) net.link.lossPercent = std::stof(args[++i]);
+            else if (args[i] == "--render-test" && hasValue) { renderTest = true; capture.steps = std::stoi(args[++i]); }
+            else if (args[i] == "--capture" && hasValue) capture.captureDir = args[++i];
+            else if (args[i] == "--capture-every" && hasValue) capture.every = std::stoi(args[++i]);
+            else if (args[i] == "--capture-format" && hasValue) capture.format = args[++i];
+            else if (args[i] == "--golden" && hasValue) capture.goldenDir = args[++i];
+            else if (args[i] == "--golden-tolerance" && hasValue) capture.tolerance = static_cast<unsigned>(std::stoul(args[++i]));
+            else { printUsage(); return 1; }
         }
+    } catch (const std::exception&) { // std::stoi / std::stoul / std::stof on a malformed number, or a count below one
+        printUsage();
+        return 1;
     }
 
-    void update(float dt) {
-        if (won) return;
-
-        sf::FloatRect world = map.worldBounds();
-        fireboy.update(dt, world);
-        watergirl.update(dt, world);
+    // online steps are rolled back and re-simulated, so the recorder would not hold the confirmed input
+    if (netPlay && !recordPath.empty()) {
+        std::cout << "--record cannot be combined with --host or --join\n";
+        return 1;
+    }
 
-        handleCollisions(fireboy, map.respawnWorldPosForFire(), fireboyAtExit, TileType::ExitFire);
-        handleCollisions(watergirl, map.respawnWorldPosForWater(), watergirlAtExit, TileType::ExitWater);
+    if (netTest) return runNetTest(net, batch.maxSteps);
 
-        if (fireboyAtExit && watergirlAtExit) {
-            // keep game state as won to stop further updates, but do not display/print anything
-            won = true;
-        }
+    if (batchMode) {
+        BatchRunner runner(batch);
+        runner.run();
+        cout << runner;
+        return 0;
     }
 
-    void render() {
-        if (headless) return;
-        if (!window) return;
-        window->clear(sf::Color(40,40,40));
-        map.draw(*window);
-        fireboy.draw(*window);
-        watergirl.draw(*window);
-        // intentionally do not draw any "WIN" text or overlay
-        window->display();
+    if (scoreMode) {
+        SeedScorer scorer(batch);
+        scorer.run();
+        cout << scorer;
+        return 0;
     }
 
-public:
-    Game(int mapW = 14, int mapH = 9)
-        : map(mapW, mapH),
-          fireboy("Fireboy", "assets/fireboy.jpeg", {Tile::getSize()*1.f, Tile::getSize()*(mapH-2.f)}, 3, sf::Color::Red),
-          watergirl("Watergirl", "assets/watergirl.jpg", {Tile::getSize()*5.f, Tile::getSize()*(mapH-2.f)}, 3, sf::Color::Blue)
-    {
-        // detect headless - verificăm DOAR dacă suntem în CI SAU nu avem DISPLAY pe Linux
-        headless = false;
-
-        const char* ciEnv = std::getenv("CI");
-        if (ciEnv != nullptr && std::string(ciEnv) == "true") {
-            std::cout << "Detected CI environment, running in headless mode.\n";
-            headless = true;
+    if (!replayPath.empty()) {
+        InputLog log;
+        if (!log.loadFromFile(replayPath)) {
+            std::cout << "Cannot read input log " << replayPath << "\n";
+            return 1;
         }
-
-#ifndef _WIN32
-        // Pe Linux/macOS verificăm DISPLAY doar dacă nu suntem deja în headless
-        if (!headless) {
-            const char* displayEnv = std::getenv("DISPLAY");
-            if (displayEnv == nullptr || std::string(displayEnv).empty()) {
-                std::cout << "No DISPLAY environment variable, running in headless mode.\n";
-                headless = true;
-            }
+        cout << log << endl;
+        // the level the session was played on: generated from the seed, or the same level file
+        Map level(log.getMapWidth(), log.getMapHeight());
+        if (log.getLevelPath().empty()) {
+            level.generateAscendingPlatforms(log.getLevelSeed(), [](const Map& m) { return LevelSolver::instance().isSolvable(m); });
+        } else if (!level.loadFromFile(log.getLevelPath())) {
+            std::cout << "Cannot load level " << log.getLevelPath() << "\n";
+            return 1;
+        } else if (InputLog::levelHashOf(level) != log.getLevelHash()) {
+            std::cout << "Level " << log.getLevelPath() << " is not the one the session was recorded on\n";
+            return 1;
         }
-#endif
-
-        if (!headless) {
-            // create the window only when running with display
-            window = std::make_unique<sf::RenderWindow>(sf::VideoMode((unsigned)(mapW*Tile::getSize()), (unsigned)(mapH*Tile::getSize())), "Fireboy & Watergirl");
-            if (!window->isOpen()) {
-                std::cout << "Failed to create window, switching to headless mode.\n";
-                window.reset();
-                headless = true;
-            }
-        } else {
-            window.reset();
+        Game game(std::move(level), true);
+        const auto t0 = std::chrono::steady_clock::now();
+        const SimulationResult res = game.replay(log);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        cout << game;
+        cout << "Replayed " << res.steps << " steps in " << seconds * 1000.0 << " ms, state hash "
+             << std::hex << game.stateHash() << std::dec << endl;
+        return 0;
+    }
+
+    const bool headless = renderTest || detectHeadless();
+    if (!headless) Game::prefetchAssets();
+
+    // build a game with map dimensions (width, height), or from a level file
+    Map level(14, 9);
+    if (levelPath.empty()) {
+        level.generateAscendingPlatforms(12345, [](const Map& m) { return LevelSolver::instance().isSolvable(m); });
+    } else {
+        const auto t0 = std::chrono::steady_clock::now();
+        if (!level.loadFromFile(levelPath)) {
+            std::cout << "Cannot load level " << levelPath << "\n";
+            return 1;
         }
-
-        map.generateAscendingPlatforms(12345);
-
-        // no font/text setup (win messages removed)
-
-        fireboy.setFallbackAppearance(sf::Color::Red);
-        watergirl.setFallbackAppearance(sf::Color::Blue);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "Loaded level " << levelPath << " (" << level.getWidth() << "x" << level.getHeight()
+                  << ") in " << ms << " ms\n";
+        if (!LevelSolver::instance().isSolvable(level)) std::cout << "Warning: no path to both exits found in this level\n";
     }
+    if (renderTest) return runRenderTest(std::move(level), capture, batch.baseSeed);
+    const int levelW = level.getWidth(), levelH = level.getHeight();
+    const std::uint64_t levelHash = InputLog::levelHashOf(level);
+    Game game(std::move(level), headless);
 
-    friend std::ostream& operator<<(std::ostream& os, const Game& g) {
-        os << "Game state:\n";
-        os << "Map: " << g.map.getWidth() << "x" << g.map.getHeight() << "\n";
-        os << "Fireboy: " << g.fireboy << "\n";
-        os << "Watergirl: " << g.watergirl << "\n";
-        // intentionally do not print "Won" status to avoid any win message
-        return os;
-    }
-    void run() {
-        if (headless) {
-            std::cout << "Headless mode: running basic simulation...\n";
-            // Rulează doar o iterație de test sau simulare simplă
-            for (int i = 0; i < 100; ++i) {
-                float dt = 0.016f; // ~60 FPS
-                update(dt);
-                if (won) {
-                    // do not print anything about winning; just break out silently
-                    break;
-                }
-            }
-            std::cout << "Headless simulation finished.\n";
-            return;
-        }
-
-        // Mod normal cu fereastră
-        sf::Clock clock;
-        while (window && window->isOpen()) {
-            sf::Event ev;
-            while (window->pollEvent(ev)) {
-                if (ev.type == sf::Event::Closed)
-                    window->close();
-            }
+    // print initial state using operator<< (scenario of use)
+    cout << game << endl;
 
-            float dt = clock.restart().asSeconds();
-            processInput(dt);
-            update(dt);
-            render();
+    InputLog log(levelW, levelH, 12345, static_cast<unsigned>(game.getSimulationRate() + 0.5f));
+    if (!levelPath.empty()) log.setLevelFile(levelPath, levelHash);
+    if (!recordPath.empty()) game.setRecorder(&log);
+    if (!profilePath.empty()) game.enableProfiling(profilePath);
+    if (rewindSeconds > 0.f) game.enableRewind(rewindSeconds);
+    game.setFramePacing(pacing);
+    game.setSimulationThread(simulationThread);
+    game.setParticleThreads(particleThreads);
+    game.setFlowThreads(flowThreads);
+
+    std::unique_ptr<NetPeer> peer;
+    if (netPlay) {
+        peer = std::make_unique<NetPeer>(game, net);
+        if (!peer->isOpen()) {
+            std::cout << "Cannot open UDP port " << net.localPort << "\n";
+            return 1;
         }
+        if (peer->isHost()) std::cout << "Hosting on UDP port " << peer->localPort() << ", waiting for the other player...\n";
+        else std::cout << "Joining " << net.remoteHost << ":" << net.remotePort << "\n";
+        if (headless) return runHeadlessPeer(*peer, game.getSimulationRate(), batch.maxSteps);
     }
 
-};
-
-
-
-int main() {
-    // build a game with map dimensions (width, height)
-    Game game(14, 9);
-
-    // print initial state using operator<< (scenario of use)
-    cout << game << endl;
-
     // run the game (this will open SFML window)
-    game.run();
+    game.run(launch);
+    if (peer) cout << *peer << endl;
+
+    if (!recordPath.empty()) {
+        if (!log.saveToFile(recordPath)) {
+            std::cout << "Cannot write input log " << recordPath << "\n";
+            return 1;
+        }
+        cout << "Recorded " << log << ", state hash " << std::hex << game.stateHash() << std::dec << endl;
+    }
 
     return 0;
-}
\ No newline at end of file
+}
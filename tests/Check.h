@@ -0,0 +1,71 @@
+#pragma once
+
+// minimal in-tree test harness (no external dependencies), the counterpart of bench/Bench.h:
+//   - a test is a named function; CHECK(expr) reports a failed expectation (file, line, expression)
+//     and the test goes on, so one run lists everything that broke
+//   - the runner prints one line per test and returns the number of failed tests (the exit code
+//     ctest looks at)
+
+#include <exception>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace check {
+
+struct Test {
+    std::string name;
+    std::function<void()> run;
+};
+
+// failed expectations of the running test, and where they are reported
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+inline std::ostream*& log() {
+    static std::ostream* os = nullptr;
+    return os;
+}
+
+inline void fail(const char* expr, const char* file, int line) {
+    if (log()) *log() << "    " << file << ":" << line << ": failed: " << expr << "\n";
+    ++failures();
+}
+
+class Runner {
+private:
+    std::vector<Test> tests;
+
+public:
+    void add(std::string name, std::function<void()> run) { tests.push_back({std::move(name), std::move(run)}); }
+
+    const std::vector<Test>& all() const { return tests; }
+
+    // run every test whose name contains `filter` (all when empty); returns the failed tests
+    int run(const std::string& filter, std::ostream& os) const {
+        log() = &os;
+        int ran = 0, failed = 0;
+        for (const Test& t : tests) {
+            if (!filter.empty() && t.name.find(filter) == std::string::npos) continue;
+            failures() = 0;
+            try {
+                t.run();
+            } catch (const std::exception& e) {
+                os << "    exception: " << e.what() << "\n";
+                ++failures();
+            }
+            ++ran;
+            if (failures() > 0) ++failed;
+            os << (failures() > 0 ? "FAIL " : "ok   ") << t.name << "\n";
+        }
+        os << ran - failed << " of " << ran << " tests passed\n";
+        log() = nullptr;
+        return failed;
+    }
+};
+
+} // namespace check
+
+#define CHECK(expr) ((expr) ? void() : ::check::fail(#expr, __FILE__, __LINE__))
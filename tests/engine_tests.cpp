@@ -0,0 +1,486 @@
+// engine_tests: checks of the pieces determinism depends on (see Check.h); run by ctest
+//   engine_tests [--filter TEXT] [--list]
+#include "Engine.h"
+#include "Check.h"
+
+#include <filesystem>
+
+namespace {
+
+// a file in the temporary directory, removed when the test is done with it
+class TempFile {
+private:
+    std::string path;
+
+public:
+    explicit TempFile(const std::string& name)
+        : path((std::filesystem::temp_directory_path() / ("oop_test_" + name)).string()) {}
+    ~TempFile() {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& str() const { return path; }
+};
+
+// runs of one step, of exactly 255 (one RLE pair), 256 and 600 (split over pairs), then a
+// different input every step
+void addInputLogTests(check::Runner& runner) {
+    runner.add("InputLog/roundTrip", [] {
+        InputLog log(20, 10, 777, 90);
+        log.setLevelFile("levels/custom.fwl", 0x0123456789ABCDEFull);
+        std::vector<std::uint8_t> expected;
+        auto append = [&](std::uint8_t bits, int count) {
+            for (int i = 0; i < count; ++i) {
+                log.append(InputFrame(bits));
+                expected.push_back(bits);
+            }
+        };
+        append(0x01, 1);
+        append(0x02, 255);
+        append(0x03, 256);
+        append(0x00, 600);
+        for (int i = 0; i < 300; ++i) append(static_cast<std::uint8_t>(i * 37), 1);
+
+        TempFile file("input.fwil");
+        CHECK(log.saveToFile(file.str()));
+        InputLog loaded;
+        CHECK(loaded.loadFromFile(file.str()));
+        CHECK(loaded.getMapWidth() == 20);
+        CHECK(loaded.getMapHeight() == 10);
+        CHECK(loaded.getLevelSeed() == 777u);
+        CHECK(loaded.getStepsPerSecond() == 90u);
+        CHECK(loaded.getLevelPath() == "levels/custom.fwl");
+        CHECK(loaded.getLevelHash() == 0x0123456789ABCDEFull);
+        CHECK(loaded.size() == expected.size());
+        bool same = loaded.size() == expected.size();
+        for (std::size_t i = 0; same && i < expected.size(); ++i) same = loaded[i].raw() == expected[i];
+        CHECK(same);
+    });
+
+    runner.add("InputLog/rejectsTruncated", [] {
+        InputLog log;
+        for (int i = 0; i < 100; ++i) log.append(InputFrame(static_cast<std::uint8_t>(i % 3)));
+        TempFile file("truncated.fwil");
+        CHECK(log.saveToFile(file.str()));
+        const auto size = std::filesystem::file_size(file.str());
+        std::filesystem::resize_file(file.str(), size - 2); // the last run is missing
+        InputLog loaded;
+        CHECK(!loaded.loadFromFile(file.str()));
+    });
+}
+
+// the map size decides what replay allocates and generates: too small to generate on (the
+// crafted version 1 log below) or too big to allocate must not load
+void addInputLogSizeTests(check::Runner& runner) {
+    runner.add("InputLog/rejectsBadMapSize", [] {
+        TempFile file("size.fwil");
+        InputLog loaded;
+
+        // "FWIL", version 1, map 4x2, seed, rate, no steps
+        const unsigned char tiny[] = {'F', 'W', 'I', 'L', 1, 4, 0, 2, 0, 0x39, 0x30, 0, 0, 120, 0, 0, 0, 0, 0, 0, 0};
+        {
+            std::ofstream out(file.str(), std::ios::binary);
+            out.write(reinterpret_cast<const char*>(tiny), sizeof(tiny));
+        }
+        CHECK(!loaded.loadFromFile(file.str()));
+
+        CHECK(InputLog(Map::MIN_GENERATED_WIDTH - 1, 9).saveToFile(file.str()));
+        CHECK(!loaded.loadFromFile(file.str()));
+        CHECK(InputLog(14, Map::MIN_GENERATED_HEIGHT - 1).saveToFile(file.str()));
+        CHECK(!loaded.loadFromFile(file.str()));
+        CHECK(InputLog(5000, 5000).saveToFile(file.str()));
+        CHECK(!loaded.loadFromFile(file.str()));
+
+        // the smallest generated level, and a small level file (nothing is generated on it)
+        CHECK(InputLog(Map::MIN_GENERATED_WIDTH, Map::MIN_GENERATED_HEIGHT).saveToFile(file.str()));
+        CHECK(loaded.loadFromFile(file.str()));
+        InputLog onFile(4, 2);
+        onFile.setLevelFile("tiny.fwl", 1);
+        CHECK(onFile.saveToFile(file.str()));
+        CHECK(loaded.loadFromFile(file.str()));
+    });
+}
+
+void addGeneratorTests(check::Runner& runner) {
+    // every size from nothing to a little above the minimum: generation happens exactly when the
+    // level fits, keeps every write inside the map (sanitizer builds catch the rest) and places both exits
+    runner.add("Map/generateAscendingPlatforms/sizes", [] {
+        bool asExpected = true, exitsPlaced = true;
+        for (int w = 1; w <= Map::MIN_GENERATED_WIDTH + 4; ++w) {
+            for (int h = 1; h <= Map::MIN_GENERATED_HEIGHT + 4; ++h) {
+                for (unsigned seed = 1; seed <= 16; ++seed) {
+                    Map map(w, h);
+                    const bool fits = w >= Map::MIN_GENERATED_WIDTH && h >= Map::MIN_GENERATED_HEIGHT;
+                    if (map.generateAscendingPlatforms(seed) != fits) asExpected = false;
+                    if (!fits) continue;
+                    int exits = 0;
+                    for (int r = 0; r < h; ++r)
+                        for (int c = 0; c < w; ++c) {
+                            const TileType t = map.getTileTypeAtGrid(c, r);
+                            exits += t == TileType::ExitFire || t == TileType::ExitWater;
+                        }
+                    if (exits != 2) exitsPlaced = false;
+                }
+            }
+        }
+        CHECK(asExpected);
+        CHECK(exitsPlaced);
+        Map tiny(4, 2);
+        CHECK(tiny.generateAscendingPlatforms(7, [](const Map&) { return true; }) == 0);
+    });
+}
+
+// random cell ranges of 1x1 to 3x3 cells, enough of them that buckets are shared
+std::vector<Map::CellRange> randomRanges(std::size_t n, int side, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> corner(0, side - 3), extent(0, 2);
+    std::vector<Map::CellRange> ranges(n);
+    for (Map::CellRange& r : ranges) {
+        r.col0 = corner(rng);
+        r.row0 = corner(rng);
+        r.col1 = r.col0 + extent(rng);
+        r.row1 = r.row0 + extent(rng);
+    }
+    return ranges;
+}
+
+bool covers(const Map::CellRange& r, int col, int row) {
+    return col >= r.col0 && col <= r.col1 && row >= r.row0 && row <= r.row1;
+}
+
+bool rangesMeet(const Map::CellRange& a, const Map::CellRange& b) {
+    return a.col0 <= b.col1 && b.col0 <= a.col1 && a.row0 <= b.row1 && b.row0 <= a.row1;
+}
+
+void addSpatialHashTests(check::Runner& runner) {
+    // every cell lists exactly the items covering it, once each, although other cells share its bucket
+    runner.add("SpatialHash/cellListsItemsOnce", [] {
+        constexpr int SIDE = 40;
+        const std::vector<Map::CellRange> ranges = randomRanges(300, SIDE, 5);
+        SpatialHash hash;
+        hash.build(ranges);
+        bool exact = true;
+        for (int row = 0; row < SIDE; ++row) {
+            for (int col = 0; col < SIDE; ++col) {
+                std::vector<int> seen(ranges.size(), 0);
+                hash.forEachInCell(col, row, [&](std::uint32_t i) { ++seen[i]; });
+                for (std::size_t i = 0; i < ranges.size(); ++i)
+                    if (seen[i] != (covers(ranges[i], col, row) ? 1 : 0)) exact = false;
+            }
+        }
+        CHECK(exact);
+    });
+
+    // a pair of entities sharing several cells reaches the narrowphase once (platforms that
+    // stand still, so nothing moves and the cell ranges stay as placed)
+    runner.add("EntityWorld/pairTestedOnce", [] {
+        constexpr int SIDE = 24;
+        const float s = Tile::getSize();
+        Map map(SIDE, SIDE);
+        EntityWorld world;
+        const std::vector<Map::CellRange> ranges = randomRanges(120, SIDE, 9);
+        for (const Map::CellRange& r : ranges) {
+            // inset from the cell edges, so the box covers exactly these cells
+            world.spawn(EntityKind::MovingPlatform, {r.col0 * s + 1.f, r.row0 * s + 1.f},
+                        {(r.col1 - r.col0 + 1) * s - 2.f, (r.row1 - r.row0 + 1) * s - 2.f});
+        }
+        world.step(1.f / 120.f, map);
+        std::size_t pairs = 0;
+        for (std::size_t i = 0; i < ranges.size(); ++i)
+            for (std::size_t j = i + 1; j < ranges.size(); ++j)
+                if (rangesMeet(ranges[i], ranges[j])) ++pairs;
+        CHECK(pairs > ranges.size() / 2); // many pairs share cells, several of them more than one
+        CHECK(world.lastCandidatePairs() == pairs);
+    });
+}
+
+// a .fwl file: the header, then `tiles` (width*height of them unless a test cuts it short)
+void writeLevel(const std::string& path, const LevelHeader& header, const std::vector<std::uint8_t>& tiles) {
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size()));
+}
+
+void addLevelFileTests(check::Runner& runner) {
+    constexpr std::uint32_t W = 13, H = 5; // 65 tiles: eight 8-byte words and a tail of one
+    LevelHeader good{};
+    std::memcpy(good.magic, LevelHeader::MAGIC, sizeof(good.magic));
+    good.version = LevelHeader::VERSION;
+    good.headerSize = sizeof(LevelHeader);
+    good.width = W;
+    good.height = H;
+    good.fireSpawnCol = 1;
+    good.fireSpawnRow = 3;
+    good.waterSpawnCol = 2;
+    good.waterSpawnRow = 3;
+    std::vector<std::uint8_t> tiles(W * H, static_cast<std::uint8_t>(TileType::Empty));
+    for (std::uint32_t c = 0; c < W; ++c) tiles[(H - 1) * W + c] = static_cast<std::uint8_t>(TileType::Solid);
+    tiles[W + 4] = static_cast<std::uint8_t>(TileType::Wood);
+
+    runner.add("Map/loadFromFile/valid", [=] {
+        TempFile file("valid.fwl");
+        writeLevel(file.str(), good, tiles);
+        Map map(3, 3);
+        CHECK(map.loadFromFile(file.str()));
+        CHECK(map.getWidth() == static_cast<int>(W));
+        CHECK(map.getHeight() == static_cast<int>(H));
+        CHECK(map.getTileTypeAtGrid(4, 1) == TileType::Wood);
+        CHECK(map.getTileTypeAtGrid(0, static_cast<int>(H) - 1) == TileType::Solid);
+        CHECK(map.getTileTypeAtGrid(0, 0) == TileType::Empty);
+        CHECK(map.respawnWorldPosForFire() == sf::Vector2f(1 * Tile::getSize(), 3 * Tile::getSize()));
+        CHECK(map.respawnWorldPosForWater() == sf::Vector2f(2 * Tile::getSize(), 3 * Tile::getSize()));
+    });
+
+    // each case breaks one thing; the map must refuse the file and keep its tiles
+    runner.add("Map/loadFromFile/rejectsMalformed", [=] {
+        struct Case {
+            const char* what;
+            LevelHeader header;
+            std::vector<std::uint8_t> tiles;
+        };
+        std::vector<Case> cases;
+        auto broken = [&](const char* what, auto change) {
+            Case c{what, good, tiles};
+            change(c);
+            cases.push_back(std::move(c));
+        };
+        broken("magic", [](Case& c) { c.header.magic[3] = 'X'; });
+        broken("version", [](Case& c) { c.header.version = LevelHeader::VERSION + 1; });
+        broken("header size", [](Case& c) { c.header.headerSize = sizeof(LevelHeader) + 4; });
+        broken("zero width", [](Case& c) { c.header.width = 0; });
+        broken("zero height", [](Case& c) { c.header.height = 0; });
+        broken("huge size", [](Case& c) { c.header.width = 0x10000; });
+        broken("missing tiles", [](Case& c) { c.tiles.pop_back(); });
+        broken("fire spawn outside", [](Case& c) { c.header.fireSpawnCol = W; });
+        broken("water spawn outside", [](Case& c) { c.header.waterSpawnRow = H; });
+        broken("tile code Count", [](Case& c) { c.tiles[10] = static_cast<std::uint8_t>(TileType::Count); });
+        broken("tile code 0x80", [](Case& c) { c.tiles[20] = 0x80; });
+        broken("tile code 0xFF in the tail", [](Case& c) { c.tiles.back() = 0xFF; });
+
+        TempFile file("malformed.fwl");
+        Map map(3, 3);
+        map.setTile(1, 1, TileType::Fire);
+        for (const Case& c : cases) {
+            writeLevel(file.str(), c.header, c.tiles);
+            const bool loaded = map.loadFromFile(file.str());
+            if (loaded) std::cout << "    accepted: " << c.what << "\n";
+            CHECK(!loaded);
+        }
+        CHECK(map.getWidth() == 3);
+        CHECK(map.getTileTypeAtGrid(1, 1) == TileType::Fire);
+
+        Map other(3, 3);
+        CHECK(!other.loadFromFile(file.str() + ".missing"));
+    });
+}
+
+// a small level the tile automaton keeps busy: water dropping onto a wooden shelf that fire eats
+Map flowingLevel() {
+    Map level(20, 12);
+    for (int c = 0; c < 20; ++c) level.setTile(c, 11, TileType::Solid);
+    for (int c = 4; c < 16; ++c) level.setTile(c, 7, TileType::Wood);
+    level.setTile(4, 6, TileType::Fire);
+    for (int r = 1; r < 4; ++r)
+        for (int c = 10; c < 14; ++c) level.setTile(c, r, TileType::Water);
+    return level;
+}
+
+void addRewindTests(check::Runner& runner) {
+    // random states that change a few bytes per tick (so both deltas and keyframes are used),
+    // tile writes journaled on a map, then restores in random order, backwards and forwards
+    runner.add("RewindBuffer/restoreMatchesCapture", [] {
+        constexpr std::size_t STATE = 200, TICKS = 300;
+        std::mt19937 rng(21);
+        std::uniform_int_distribution<std::size_t> pos(0, STATE - 1);
+        std::uniform_int_distribution<int> byte(0, 255), col(0, 15), row(0, 9), tile(0, static_cast<int>(TileType::Count) - 1);
+
+        Map map(16, 10);
+        map.recordTileChanges(true);
+        RewindBuffer history(STATE, TICKS + 1);
+        std::vector<std::uint8_t> state(STATE, 0);
+        std::vector<std::vector<std::uint8_t>> states, tiles;
+        auto capture = [&] {
+            history.capture(state.data(), map.pendingTileChanges());
+            map.clearTileChanges();
+            states.push_back(state);
+            tiles.emplace_back(map.tileData(), map.tileData() + 16 * 10);
+        };
+        capture();
+        for (std::size_t t = 1; t <= TICKS; ++t) {
+            for (int k = 0; k < 3; ++k) state[pos(rng)] = static_cast<std::uint8_t>(byte(rng));
+            if (t % 4 == 0) map.setTile(col(rng), row(rng), static_cast<TileType>(tile(rng)));
+            capture();
+        }
+        CHECK(history.oldestTick() == 0);
+        CHECK(history.newestTick() == TICKS);
+
+        bool same = true;
+        std::uniform_int_distribution<std::uint64_t> tick(0, TICKS);
+        for (int i = 0; i < 200; ++i) {
+            const std::uint64_t t = i == 0 ? 0 : i == 1 ? TICKS : tick(rng);
+            const std::uint8_t* restored = history.restore(t, map);
+            if (!restored || std::memcmp(restored, states[t].data(), STATE) != 0 ||
+                std::memcmp(map.tileData(), tiles[t].data(), tiles[t].size()) != 0)
+                same = false;
+        }
+        CHECK(same);
+        CHECK(history.restore(TICKS + 1, map) == nullptr);
+    });
+
+    // the oldest steps are dropped once the buffer is full; what is kept still restores exactly
+    runner.add("RewindBuffer/dropsOldest", [] {
+        constexpr std::size_t STATE = 64, KEEP = 100, TICKS = 500;
+        Map map(4, 4);
+        RewindBuffer history(STATE, KEEP);
+        std::vector<std::uint8_t> state(STATE, 0);
+        for (std::size_t t = 0; t <= TICKS; ++t) {
+            state[t % STATE] = static_cast<std::uint8_t>(t);
+            history.capture(state.data(), map.pendingTileChanges());
+        }
+        CHECK(history.newestTick() == TICKS);
+        CHECK(history.newestTick() - history.oldestTick() + 1 >= KEEP);
+        CHECK(history.restore(0, map) == nullptr);
+        const std::uint64_t oldest = history.oldestTick();
+        const std::uint8_t* restored = history.restore(oldest, map);
+        CHECK(restored != nullptr);
+        if (restored) {
+            // rebuild that tick's state the way it was written
+            std::vector<std::uint8_t> expected(STATE, 0);
+            for (std::size_t t = 0; t <= oldest; ++t) expected[t % STATE] = static_cast<std::uint8_t>(t);
+            CHECK(std::memcmp(restored, expected.data(), STATE) == 0);
+        }
+    });
+
+    // a whole game, tiles included: every kept tick comes back with the state hash it had, and
+    // playing on from a rewound tick with the same input gives the same hashes again
+    runner.add("Game/rewindToMatchesStep", [] {
+        constexpr std::size_t STEPS = 480;
+        Game game(flowingLevel(), true);
+        game.enableRewind(10.f);
+        ScriptedInput script(4);
+        std::vector<InputFrame> inputs;
+        std::vector<std::uint64_t> hashes{game.stateHash()};
+        for (std::size_t i = 0; i < STEPS; ++i) {
+            inputs.push_back(script.next());
+            game.step(inputs.back());
+            hashes.push_back(game.stateHash());
+        }
+        CHECK(hashes[STEPS] != hashes[STEPS / 2]); // still changing halfway through
+
+        bool same = true;
+        for (std::uint64_t t : {STEPS / 3, std::size_t{0}, STEPS - 1, STEPS / 2, std::size_t{7}})
+            same = same && game.rewindTo(t) && game.stateHash() == hashes[t];
+        CHECK(same);
+
+        CHECK(game.rewindTo(100));
+        bool replayed = true;
+        for (std::size_t i = 100; i < STEPS; ++i) {
+            game.step(inputs[i]);
+            replayed = replayed && game.stateHash() == hashes[i + 1];
+        }
+        CHECK(replayed);
+    });
+}
+
+// floors every 8 rows with gaps and wood, blocks of water above them and fires on the wood,
+// over several automaton blocks
+Map randomFlowLevel(int side, unsigned seed) {
+    Map level(side, side);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> roll(0, 99), spot(1, side - 8);
+    for (int r = 8; r < side; r += 8)
+        for (int c = 0; c < side; ++c)
+            if (const int k = roll(rng); k >= 15) level.setTile(c, r, k < 35 ? TileType::Wood : TileType::Solid);
+    for (int i = 0; i < side / 4; ++i) {
+        const int c0 = spot(rng), r0 = spot(rng);
+        for (int r = r0; r < r0 + 5; ++r)
+            for (int c = c0; c < c0 + 5; ++c)
+                if (level.getTileTypeAtGrid(c, r) == TileType::Empty) level.setTile(c, r, TileType::Water);
+    }
+    for (int i = 0; i < side / 8; ++i) {
+        const int c = spot(rng), r = spot(rng) / 8 * 8;
+        if (r > 0 && level.getTileTypeAtGrid(c, r) == TileType::Wood) level.setTile(c, r, TileType::Fire);
+    }
+    return level;
+}
+
+bool sameTiles(const Map& a, const Map& b) {
+    return a.getWidth() == b.getWidth() && a.getHeight() == b.getHeight() &&
+           std::memcmp(a.tileData(), b.tileData(), static_cast<std::size_t>(a.getWidth()) * a.getHeight()) == 0;
+}
+
+void addTileAutomatonTests(check::Runner& runner) {
+    // skipping the sleeping blocks must not change a single tile, on one thread or several
+    runner.add("TileAutomaton/awakeMatchesWakeAll", [] {
+        constexpr int SIDE = 100; // 7x7 blocks, the last row and column partial
+        const Map level = randomFlowLevel(SIDE, 3);
+        Map awakeOnly(level), everyBlock(level), threaded(level);
+        TileAutomaton awakeFlow, allFlow, threadedFlow;
+        threadedFlow.setWorkers(4);
+        const std::vector<Map::CellRange> bodies{{20, 21, 5, 6}, {60, 60, 30, 31}};
+        bool same = true, slept = false;
+        std::size_t changes = 0;
+        for (std::uint32_t i = 0; i < 300; ++i) {
+            allFlow.wakeAll();
+            changes += awakeFlow.step(awakeOnly, i, bodies);
+            allFlow.step(everyBlock, i, bodies);
+            threadedFlow.step(threaded, i, bodies);
+            same = same && sameTiles(awakeOnly, everyBlock) && sameTiles(awakeOnly, threaded);
+            slept = slept || awakeFlow.steppedBlocks() < awakeFlow.blockCount();
+        }
+        CHECK(changes > 1000); // the level kept the automaton busy
+        CHECK(slept);          // and blocks did sleep
+        CHECK(same);
+    });
+
+    // liquids wait beside the cells bodies stand in
+    runner.add("TileAutomaton/bodiesKeepLiquidsOut", [] {
+        Map map(8, 8);
+        for (int c = 0; c < 8; ++c) map.setTile(c, 7, TileType::Solid);
+        map.setTile(3, 2, TileType::Water);
+        TileAutomaton flow;
+        const std::vector<Map::CellRange> bodies{{3, 3, 5, 6}};
+        for (std::uint32_t i = 0; i < 20; ++i) flow.step(map, i, bodies);
+        CHECK(map.getTileTypeAtGrid(3, 5) == TileType::Empty);
+        CHECK(map.getTileTypeAtGrid(3, 6) == TileType::Empty);
+        int water = 0;
+        for (int r = 0; r < 8; ++r)
+            for (int c = 0; c < 8; ++c) water += map.getTileTypeAtGrid(c, r) == TileType::Water;
+        CHECK(water == 1);
+    });
+}
+
+void printUsage() {
+    std::cout << "usage: engine_tests [--filter TEXT] [--list]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::vector<std::string> args(argv + 1, argv + argc);
+    std::string filter;
+    bool listOnly = false;
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--filter" && i + 1 < args.size()) filter = args[++i];
+        else if (args[i] == "--list") listOnly = true;
+        else { printUsage(); return 1; }
+    }
+
+    check::Runner runner;
+    addInputLogTests(runner);
+    addInputLogSizeTests(runner);
+    addGeneratorTests(runner);
+    addSpatialHashTests(runner);
+    addLevelFileTests(runner);
+    addRewindTests(runner);
+    addTileAutomatonTests(runner);
+
+    if (listOnly) {
+        for (const check::Test& t : runner.all()) std::cout << t.name << "\n";
+        return 0;
+    }
+    return runner.run(filter, std::cout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+// level_converter: turns a text level into the binary .fwl format loaded by the game
+// usage: level_converter <input.txt> <output.fwl>
+#include "LevelFormat.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct Cell {
+    std::uint16_t col = 0, row = 0;
+    bool found = false;
+};
+
+static void remember(Cell& cell, std::size_t col, std::size_t row, const char* what, std::size_t line) {
+    if (cell.found) std::cerr << "warning: line " << line << ": more than one " << what << ", keeping the first\n";
+    else cell = {static_cast<std::uint16_t>(col), static_cast<std::uint16_t>(row), true};
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "usage: level_converter <input.txt> <output.fwl>\n";
+        return 1;
+    }
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::cerr << "cannot open " << argv[1] << "\n";
+        return 1;
+    }
+
+    vector<std::uint8_t> tiles;
+    std::size_t width = 0, height = 0, lineNo = 0;
+    Cell fireSpawn, waterSpawn, fireExit, waterExit;
+    string line;
+    while (std::getline(in, line)) {
+        ++lineNo;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == ';') continue;
+        if (width == 0) width = line.size();
+        if (line.size() != width) {
+            std::cerr << "line " << lineNo << ": row has " << line.size() << " tiles, expected " << width << "\n";
+            return 1;
+        }
+        for (std::size_t col = 0; col < width; ++col) {
+            TileType t{};
+            if (!tileFromLevelChar(line[col], t)) {
+                std::cerr << "line " << lineNo << ": unknown tile '" << line[col] << "'\n";
+                return 1;
+            }
+            if (line[col] == '1') remember(fireSpawn, col, height, "Fireboy spawn", lineNo);
+            if (line[col] == '2') remember(waterSpawn, col, height, "Watergirl spawn", lineNo);
+            if (t == TileType::ExitFire) remember(fireExit, col, height, "fire exit", lineNo);
+            if (t == TileType::ExitWater) remember(waterExit, col, height, "water exit", lineNo);
+            tiles.push_back(static_cast<std::uint8_t>(t));
+        }
+        ++height;
+    }
+
+    if (width == 0 || height == 0) {
+        std::cerr << "empty level\n";
+        return 1;
+    }
+    if (width > 0xFFFF || height > 0xFFFF) {
+        std::cerr << "level too large (max 65535 tiles per side)\n";
+        return 1;
+    }
+    if (!fireSpawn.found || !waterSpawn.found) {
+        std::cerr << "level needs both spawns ('1' for Fireboy, '2' for Watergirl)\n";
+        return 1;
+    }
+
+    LevelHeader header{};
+    std::memcpy(header.magic, LevelHeader::MAGIC, sizeof(header.magic));
+    header.version = LevelHeader::VERSION;
+    header.headerSize = sizeof(LevelHeader);
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.fireSpawnCol = fireSpawn.col;
+    header.fireSpawnRow = fireSpawn.row;
+    header.waterSpawnCol = waterSpawn.col;
+    header.waterSpawnRow = waterSpawn.row;
+    header.fireExitCol = fireExit.col;
+    header.fireExitRow = fireExit.row;
+    header.waterExitCol = waterExit.col;
+    header.waterExitRow = waterExit.row;
+
+    std::ofstream out(argv[2], std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(tiles.data()), static_cast<std::streamsize>(tiles.size()));
+    if (!out) {
+        std::cerr << "cannot write " << argv[2] << "\n";
+        return 1;
+    }
+    std::cout << "wrote " << argv[2] << ": " << width << "x" << height << " tiles\n";
+    return 0;
+}